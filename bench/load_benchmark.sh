@@ -0,0 +1,65 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# End-to-end benchmark: time until a SIARD archive is a queryable sqlite3 database.
+# For each output mode of the converter, a generated archive (see load_corpus.sh)
+# is converted and the SQL loaded into a new database with sqlite_load, reporting:
+#
+#   conv ms    conversion time (siard2sql)
+#   sql MB     size of the SQL file
+#   load ms    time to run the SQL file as is (as 'sqlite3 db < file.sql')
+#   txn ms     time to run the SQL file in one transaction
+#   query ms   time of the first query (count the rows of every table)
+#   total ms   conv + load + query, the time until the database can be queried
+#   db MB      size of the database
+#
+# Usage: load_benchmark.sh [siard2sql binary] [sqlite_load binary] [rows]
+#
+# Other archives (.siard files or directories) can be added with the environment
+# variable ARCHIVES. Modes are given by MODES, a list of name:options.
+
+BIN=${1:-run-linux/siard2sql}
+LOADER=${2:-run-linux/sqlite_load}
+ROWS=${3:-20000}
+MODES=${MODES:-"plain: optimize:-O lobs-last:-L chunked:-C,65536 all:-O,-L,-C,65536"}
+
+BENCHDIR=$(dirname "$0")
+TMP=$(mktemp -d /tmp/_s2s_lbXXXXXX)
+trap 'rm -rf "$TMP"' EXIT
+
+"$BENCHDIR/load_corpus.sh" "$TMP/corpus" $ROWS || exit 1
+
+ms_since() { echo $(( ($(date +%s%N) - $1) / 1000000 )); }
+mb() { awk -v b=$1 'BEGIN { printf "%.1f", b / 1048576 }'; }
+
+fail=0
+printf "%-12s %-10s %8s %8s %8s %8s %8s %8s %8s\n" archive mode "conv ms" "sql MB" "load ms" "txn ms" "query ms" "total ms" "db MB"
+for archive in "$TMP/corpus" $ARCHIVES; do
+    name=$(basename "$archive"); name=${name%.siard}
+    for mode in $MODES; do
+        opts=${mode#*:}
+        t0=$(date +%s%N)
+        if ! "$BIN" ${opts//,/ } "$archive" "$TMP/out.sql" > /dev/null 2>&1; then
+            echo "FAILED converting $archive (${mode%%:*})" >&2; fail=1; continue
+        fi
+        conv=$(ms_since $t0)
+        sqlsize=$(stat -c %s "$TMP/out.sql")
+        if ! read load query dbsize rows < <("$LOADER" "$TMP/out.db" "$TMP/out.sql") \
+           || ! read txn _ _ _ < <("$LOADER" -t "$TMP/out.db" "$TMP/out.sql"); then
+            echo "FAILED loading $archive (${mode%%:*})" >&2; fail=1; continue
+        fi
+        printf "%-12s %-10s %8d %8s %8d %8d %8d %8d %8s\n" "$name" "${mode%%:*}" $conv $(mb $sqlsize) \
+               $load $txn $query $((conv + load + query)) $(mb $dbsize)
+    done
+done
+
+exit $fail
@@ -0,0 +1,115 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# Generate an (unzipped) SIARD directory resembling a typical archived database,
+# for the load-time benchmark (see load_benchmark.sh):
+#
+#   customer  'rows' rows: integer primary key, names, dates, decimals, and a short CLOB
+#   document  'rows'/10 rows: integer primary key, a foreign key to customer, a title
+#             and a BLOB of 'lobsize' bytes stored as an external LOB file
+#
+# Usage: load_corpus.sh outdir rows [lobsize]
+#
+# The output directory can be passed directly to siard2sql as a SIARD file.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 outdir rows [lobsize]" >&2
+    exit 1
+fi
+
+out=$1
+rows=$2
+lobsize=${3:-16384}
+docs=$(( (rows + 9) / 10 ))
+
+NS_META="http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd"
+NS_TABLE="http://www.bar.admin.ch/xmlns/siard/2/table.xsd"
+
+rm -rf "$out"
+mkdir -p "$out/header/siardversion/2.1" "$out/content/schema0/table0" "$out/content/schema0/table1/lob4"
+
+column_xml() { # name, type
+    echo "<column><name>$1</name><type>$2</type><nullable>true</nullable></column>"
+}
+
+cat > "$out/header/metadata.xml" <<EOF
+<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<siardArchive xmlns="$NS_META" version="2.1">
+<dbname>loadbench</dbname>
+<schemas>
+<schema>
+<name>lb</name>
+<folder>schema0</folder>
+<tables>
+<table>
+<name>customer</name>
+<folder>table0</folder>
+<columns>
+$(column_xml id INTEGER)
+$(column_xml first_name "VARCHAR(45)")
+$(column_xml last_name "VARCHAR(45)")
+$(column_xml birth DATE)
+$(column_xml balance "DECIMAL(12,2)")
+$(column_xml notes "CLOB")
+</columns>
+<primaryKey><name>PRIMARY</name><column>id</column></primaryKey>
+<rows>$rows</rows>
+</table>
+<table>
+<name>document</name>
+<folder>table1</folder>
+<columns>
+$(column_xml id INTEGER)
+$(column_xml customer_id INTEGER)
+$(column_xml title "VARCHAR(100)")
+$(column_xml payload "BLOB")
+</columns>
+<primaryKey><name>PRIMARY</name><column>id</column></primaryKey>
+<foreignKeys><foreignKey><name>fk_customer</name><referencedSchema>lb</referencedSchema>
+<referencedTable>customer</referencedTable><reference><column>customer_id</column>
+<referenced>id</referenced></reference></foreignKey></foreignKeys>
+<rows>$docs</rows>
+</table>
+</tables>
+</schema>
+</schemas>
+</siardArchive>
+EOF
+
+awk -v rows=$rows -v ns="$NS_TABLE" 'BEGIN {
+    srand(1);
+    print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    print "<table xmlns=\"" ns "\" version=\"2.1\">";
+    for (r = 1; r <= rows; r++) {
+        printf "<row><c1>%d</c1><c2>Name%d</c2><c3>O&apos;Surname%d</c3>", r, r % 997, r % 1009;
+        printf "<c4>19%02d-%02d-%02d</c4><c5>%.2f</c5>", 40 + r % 60, 1 + r % 12, 1 + r % 28, rand() * 100000;
+        printf "<c6>Customer %d since %d, preferred contact by mail</c6></row>\n", r, 1990 + r % 30;
+    }
+    print "</table>";
+}' > "$out/content/schema0/table0/table0.xml"
+
+# LOB files of pseudo-random bytes (the same content for all the documents, it is not compressed by the converter)
+head -c $lobsize /dev/urandom > "$out/content/schema0/table1/lob4/record0.bin"
+awk -v docs=$docs -v rows=$rows -v lobsize=$lobsize -v ns="$NS_TABLE" 'BEGIN {
+    print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    print "<table xmlns=\"" ns "\" version=\"2.1\">";
+    for (r = 1; r <= docs; r++) {
+        printf "<row><c1>%d</c1><c2>%d</c2><c3>Document %d</c3>", r, 1 + (r * 7) % rows, r;
+        printf "<c4 file=\"content/schema0/table1/lob4/record%d.bin\" length=\"%d\"/></row>\n", r - 1, lobsize;
+    }
+    print "</table>";
+}' > "$out/content/schema0/table1/table1.xml"
+for ((d = 1; d < docs; d++)); do
+    ln "$out/content/schema0/table1/lob4/record0.bin" "$out/content/schema0/table1/lob4/record$d.bin"
+done
@@ -0,0 +1,75 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# Scaling sweep: for each archive shape (see shape_corpus.sh) and each thread count
+# N from 1 to the number of cores, one conversion of the archive runs with N threads
+# (siard2sql -T N), reporting its wall time (best of REPEAT runs), the speedup
+# relative to 1 thread, the parallel efficiency (speedup/N) and the time of each
+# stage (inflate, parse, encode, write, as logged by the library at level 'info').
+# Only the inflation of large zip entries runs in parallel, so the stages whose time
+# does not drop with N are the ones limiting the scaling on this host. Entries are
+# inflated in parallel if they have at least 2 MB of compressed data, or a seek index:
+# set REPACK to the siard-repack binary to repack each archive first (see README).
+#
+# Usage: scaling_sweep.sh [siard2sql binary] [scale]
+#
+# Environment: SHAPES (list of shapes), THREADS (list of thread counts, by default
+# 1 2 4 ... up to the number of cores), REPEAT (runs per thread count, 3 by default),
+# REPACK (siard-repack binary), OPTS (other options for siard2sql, e.g. -M)
+
+BIN=${1:-run-linux/siard2sql}
+SCALE=${2:-4}
+SHAPES=${SHAPES:-"manytables onetable lobs complex"}
+REPEAT=${REPEAT:-3}
+NCORES=$(nproc)
+if [ -z "$THREADS" ]; then
+    for ((n = 1; n < NCORES; n *= 2)); do THREADS+="$n "; done
+    THREADS+=$NCORES
+fi
+
+BENCHDIR=$(dirname "$0")
+TMP=$(mktemp -d /tmp/_s2s_swXXXXXX)
+trap 'rm -rf "$TMP"' EXIT
+
+printf "%-11s %4s %9s %8s %6s %9s %9s %9s %9s\n" shape N "wall ms" speedup eff "inflate" "parse" "encode" "write"
+for shape in $SHAPES; do
+    "$BENCHDIR/shape_corpus.sh" "$TMP/$shape.siard" $shape $SCALE || exit 1
+    if [ -n "$REPACK" ]; then
+        "$REPACK" "$TMP/$shape.siard" "$TMP/$shape.repacked.siard" > /dev/null || exit 1
+        mv "$TMP/$shape.repacked.siard" "$TMP/$shape.siard"
+    fi
+    t1=
+    for n in $THREADS; do
+        wall=
+        for ((k = 0; k < REPEAT; k++)); do
+            t0=$(date +%s%N)
+            SIARD2SQL_LOG_LEVEL=info "$BIN" $OPTS -T $n "$TMP/$shape.siard" "$TMP/out.sql" > /dev/null 2> "$TMP/log" \
+                || { echo "FAILED converting $shape with $n threads" >&2; exit 1; }
+            ms=$(( ($(date +%s%N) - t0) / 1000000 ))
+            [ $ms -lt 1 ] && ms=1
+            if [ -z "$wall" ] || [ $ms -lt $wall ]; then
+                wall=$ms
+                mv "$TMP/log" "$TMP/best.log"
+            fi
+        done
+        [ -z "$t1" ] && t1=$wall
+        # Stage times logged by the best run
+        stages=$(awk '/Stage times/ { i = $5; p = $7; e = $9; w = $11; c = 1 }
+                     END { if (c) printf "%.0f %.0f %.0f %.0f", i, p, e, w; else print "- - - -" }' "$TMP/best.log")
+        rm -f "$TMP"/*.log "$TMP/out.sql"
+        awk -v shape=$shape -v n=$n -v wall=$wall -v t1=$t1 -v stages="$stages" 'BEGIN {
+            split(stages, s, " ");
+            speedup = t1 / wall;
+            printf "%-11s %4d %9d %8.2f %5.0f%% %9s %9s %9s %9s\n", shape, n, wall, speedup, 100 * speedup / n, s[1], s[2], s[3], s[4];
+        }'
+    done
+done
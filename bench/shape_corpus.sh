@@ -0,0 +1,151 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# Generate a SIARD file (zipped, deflated) of a given shape, for the scaling
+# sweep (see scaling_sweep.sh); its size grows linearly with 'scale':
+#
+#   manytables  100*scale small tables of 20 rows
+#   onetable    one table of 20000*scale rows
+#   lobs        one table of 50*scale rows, each one with a 64KB external CLOB file
+#   complex     2000*scale rows with a UDT column (3 attributes) and an array of 10 elements
+#
+# Usage: shape_corpus.sh out.siard shape scale
+
+set -e
+
+if [ $# -ne 3 ]; then
+    echo "Usage: $0 out.siard {manytables|onetable|lobs|complex} scale" >&2
+    exit 1
+fi
+
+out=$1
+shape=$2
+scale=$3
+
+NS_META="http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd"
+NS_TABLE="http://www.bar.admin.ch/xmlns/siard/2/table.xsd"
+
+dir=$(mktemp -d /tmp/_s2s_shapeXXXXXX)
+trap 'rm -rf "$dir"' EXIT
+mkdir -p "$dir/header/siardversion/2.1"
+
+column_xml() { # name, type-or-(typeSchema:typeName)[, cardinality]
+    echo "<column><name>$1</name>"
+    case "$2" in
+        *:*) echo "<typeSchema>${2%%:*}</typeSchema><typeName>${2#*:}</typeName>" ;;
+        *)   echo "<type>$2</type>" ;;
+    esac
+    [ -n "$3" ] && echo "<cardinality>$3</cardinality>"
+    echo "<nullable>true</nullable></column>"
+}
+
+table_meta() { # name, folder, columns, rows
+    echo "<table><name>$1</name><folder>$2</folder><columns>$3</columns>"
+    echo "<primaryKey><name>PRIMARY</name><column>id</column></primaryKey><rows>$4</rows></table>"
+}
+
+# metadata.xml: $1 = <types> element (may be empty), $2 = <table> elements
+metadata_xml() {
+    cat > "$dir/header/metadata.xml" <<EOF
+<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<siardArchive xmlns="$NS_META" version="2.1">
+<dbname>$shape</dbname>
+<schemas>
+<schema>
+<name>sh</name>
+<folder>schema0</folder>
+$1
+<tables>
+$2
+</tables>
+</schema>
+</schemas>
+</siardArchive>
+EOF
+}
+
+# Rows of a plain table: id, code, name, date, amount
+plain_rows() { # file, rows
+    awk -v rows=$2 -v ns="$NS_TABLE" 'BEGIN {
+        print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+        print "<table xmlns=\"" ns "\" version=\"2.1\">";
+        for (r = 1; r <= rows; r++)
+            printf "<row><c1>%d</c1><c2>C%05d</c2><c3>Item &apos;%d&apos; of the catalogue</c3><c4>20%02d-%02d-%02d</c4><c5>%d.%02d</c5></row>\n",
+                   r, r % 99991, r, r % 25, 1 + r % 12, 1 + r % 28, r * 37 % 100000, r % 100;
+        print "</table>";
+    }' > "$1"
+}
+plain_columns="$(column_xml id INTEGER; column_xml code "VARCHAR(8)"; column_xml name "VARCHAR(100)"; column_xml day DATE; column_xml amount "DECIMAL(10,2)")"
+
+case "$shape" in
+    manytables)
+        ntables=$((100 * scale))
+        tables=""
+        for ((t = 0; t < ntables; t++)); do
+            tables+=$(table_meta t$t table$t "$plain_columns" 20)
+            mkdir -p "$dir/content/schema0/table$t"
+            plain_rows "$dir/content/schema0/table$t/table$t.xml" 20
+        done
+        metadata_xml "" "$tables"
+        ;;
+    onetable)
+        rows=$((20000 * scale))
+        metadata_xml "" "$(table_meta big table0 "$plain_columns" $rows)"
+        mkdir -p "$dir/content/schema0/table0"
+        plain_rows "$dir/content/schema0/table0/table0.xml" $rows
+        ;;
+    lobs)
+        rows=$((50 * scale))
+        lobdir="content/schema0/table0/lob2"
+        metadata_xml "" "$(table_meta docs table0 "$(column_xml id INTEGER; column_xml body CLOB)" $rows)"
+        mkdir -p "$dir/$lobdir"
+        for ((r = 0; r < rows; r++)); do
+            # Text of random bytes in base64, which deflate compresses to about 75%
+            head -c 49152 /dev/urandom | base64 -w 76 > "$dir/$lobdir/record$r.txt"
+        done
+        awk -v rows=$rows -v lobdir=$lobdir -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            for (r = 0; r < rows; r++)
+                printf "<row><c1>%d</c1><c2 file=\"%s/record%d.txt\"/></row>\n", r + 1, lobdir, r;
+            print "</table>";
+        }' > "$dir/content/schema0/table0/table0.xml"
+        ;;
+    complex)
+        rows=$((2000 * scale))
+        types="<types><type><name>address</name><category>udt</category><attributes>
+<attribute><name>street</name><type>VARCHAR(100)</type></attribute>
+<attribute><name>city</name><type>VARCHAR(50)</type></attribute>
+<attribute><name>zip</name><type>INTEGER</type></attribute>
+</attributes></type></types>"
+        metadata_xml "$types" "$(table_meta people table0 "$(column_xml id INTEGER; column_xml addr "sh:address"; column_xml phones "VARCHAR(20)" 10)" $rows)"
+        mkdir -p "$dir/content/schema0/table0"
+        awk -v rows=$rows -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            for (r = 1; r <= rows; r++) {
+                line = sprintf("<row><c1>%d</c1><c2><u1>%d Main Street</u1><u2>City%d</u2><u3>%05d</u3></c2><c3>", r, r, r % 500, r % 99999);
+                for (a = 1; a <= 10; a++) line = line sprintf("<a%d>+34 600 %06d</a%d>", a, (r * 10 + a) % 1000000, a);
+                print line "</c3></row>";
+            }
+            print "</table>";
+        }' > "$dir/content/schema0/table0/table0.xml"
+        ;;
+    *)
+        echo "Unknown shape '$shape'" >&2
+        exit 1
+        ;;
+esac
+
+rm -f "$out"
+out=$(realpath "$out")
+(cd "$dir" && zip -qr "$out" header content)
@@ -0,0 +1,123 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// Load a SQL file generated by siard2sql into a new sqlite3 database and
+// measure the time until it can be queried (see load_benchmark.sh)
+//
+// Usage: sqlite_load [-t] database.db file.sql
+//        -t  run the whole SQL file in one transaction (by default it is run as is,
+//            as 'sqlite3 database.db < file.sql' would do)
+//
+// Print one line: "<load ms> <first query ms> <database bytes> <rows>", where the
+// first query counts the rows of every table
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *name) {
+    FILE *f = fopen(name, "rb");
+    if (!f) return NULL;
+    struct stat st;
+    char *buf = NULL;
+    if (!fstat(fileno(f), &st) && (buf = malloc(st.st_size + 1))) {
+        if (fread(buf, 1, st.st_size, f) != (size_t)st.st_size) {
+            free(buf);
+            buf = NULL;
+        } else {
+            buf[st.st_size] = '\0';
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+static int count_rows(void *acc, int ncols, char **vals, char **names) {
+    (void) ncols;
+    (void) names;
+    if (vals[0]) *(long*)acc += atol(vals[0]);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int one_transaction = 0;
+    int argi = 1;
+    if (argi < argc && !strcmp(argv[argi], "-t")) {
+        one_transaction = 1;
+        argi++;
+    }
+    if (argc - argi != 2) {
+        fprintf(stderr, "Usage: %s [-t] database.db file.sql\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *dbname = argv[argi], *sqlname = argv[argi+1];
+
+    char *sql = read_file(sqlname);
+    if (!sql) {
+        fprintf(stderr, "Error reading '%s'\n", sqlname);
+        return EXIT_FAILURE;
+    }
+
+    unlink(dbname);
+    sqlite3 *db;
+    char *err = NULL;
+    double t0 = now_ms();
+    if (sqlite3_open(dbname, &db) != SQLITE_OK) {
+        fprintf(stderr, "Error opening '%s': %s\n", dbname, sqlite3_errmsg(db));
+        return EXIT_FAILURE;
+    }
+    if (one_transaction) sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        fprintf(stderr, "Error loading '%s': %s\n", sqlname, err);
+        sqlite3_free(err);
+        sqlite3_close(db);
+        return EXIT_FAILURE;
+    }
+    if (one_transaction) sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+    double t1 = now_ms();
+
+    // First query: build the count over all the tables (views excluded, they may
+    // duplicate a table reordered physically)
+    long rows = 0;
+    char *q = NULL;
+    sqlite3_stmt *st;
+    if (sqlite3_prepare_v2(db, "SELECT group_concat('SELECT count(*) FROM \"' || replace(name, '\"', '\"\"') || '\"', ';') "
+                               "FROM sqlite_master WHERE type = 'table'", -1, &st, NULL) == SQLITE_OK
+        && sqlite3_step(st) == SQLITE_ROW && sqlite3_column_text(st, 0)) {
+        q = strdup((const char*)sqlite3_column_text(st, 0));
+    }
+    sqlite3_finalize(st);
+    if (q && sqlite3_exec(db, q, count_rows, &rows, &err) != SQLITE_OK) {
+        fprintf(stderr, "Error querying '%s': %s\n", dbname, err);
+        sqlite3_free(err);
+    }
+    double t2 = now_ms();
+    sqlite3_close(db);
+
+    struct stat sdb;
+    long dbsize = stat(dbname, &sdb) ? -1 : (long)sdb.st_size;
+    printf("%.0f %.0f %ld %ld\n", t1 - t0, t2 - t1, dbsize, rows);
+
+    free(q);
+    free(sql);
+    return EXIT_SUCCESS;
+}
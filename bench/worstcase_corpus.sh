@@ -0,0 +1,188 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# Generate an (unzipped) SIARD directory with worst-case inputs for the converter,
+# whose size grows linearly with 'scale':
+#
+#   wide      a table with 250*scale columns (2000 for scale 8), 10 rows
+#   hugecell  one row with a single inline text cell of scale*256KB, escape-dense
+#   escapes   200*scale rows of escape-dense text (\u00xx, quotes, entities)
+#   deep      UDT columns nested 12*scale levels deep (96 for scale 8), 40 rows; as the
+#             XML parser allows 500 levels, scale must be at most 40
+#   array     one array column of cardinality 500*scale, 10 rows
+#
+# Usage: worstcase_corpus.sh outdir kind scale
+#
+# The output directory can be passed directly to siard2sql as a SIARD file.
+# Notice the SQL generated for 'deep' and 'array' exceeds some default limits of
+# sqlite3 (parser stack depth, number of arguments of json_array()); they are
+# meant to stress the converter only.
+
+set -e
+
+if [ $# -ne 3 ]; then
+    echo "Usage: $0 outdir {wide|hugecell|escapes|deep|array} scale" >&2
+    exit 1
+fi
+
+out=$1
+kind=$2
+scale=$3
+
+NS_META="http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd"
+NS_TABLE="http://www.bar.admin.ch/xmlns/siard/2/table.xsd"
+
+# Escape-dense SIARD text: escaped backslash, control chars, multiple spaces,
+# quotes and XML entities (36 chars per unit when decoded)
+ESC_UNIT='x\y'"'"'\u0000  &amp;&lt;q\u001f'"''"'&gt;"z\u007f'
+
+rm -rf "$out"
+mkdir -p "$out/header/siardversion/2.1" "$out/content/schema0/table0"
+
+column_xml() { # name, type-or-(typeSchema:typeName)[, cardinality]
+    echo "<column><name>$1</name>"
+    case "$2" in
+        *:*) echo "<typeSchema>${2%%:*}</typeSchema><typeName>${2#*:}</typeName>" ;;
+        *)   echo "<type>$2</type>" ;;
+    esac
+    [ -n "$3" ] && echo "<cardinality>$3</cardinality>"
+    echo "<nullable>true</nullable></column>"
+}
+
+# metadata.xml: $1 = <types> element (may be empty), $2 = <columns> content, $3 = rows
+metadata_xml() {
+    cat > "$out/header/metadata.xml" <<EOF
+<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+<siardArchive xmlns="$NS_META" version="2.1">
+<dbname>worstcase</dbname>
+<schemas>
+<schema>
+<name>wc</name>
+<folder>schema0</folder>
+$1
+<tables>
+<table>
+<name>$kind</name>
+<folder>table0</folder>
+<columns>
+$2
+</columns>
+<rows>$3</rows>
+</table>
+</tables>
+</schema>
+</schemas>
+</siardArchive>
+EOF
+}
+
+table_xml="$out/content/schema0/table0/table0.xml"
+
+case "$kind" in
+    wide)
+        ncols=$((250 * scale))
+        rows=10
+        metadata_xml "" "$(for ((c = 1; c <= ncols; c++)); do column_xml col$c "VARCHAR(64)"; done)" $rows
+        awk -v rows=$rows -v ncols=$ncols -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            for (r = 0; r < rows; r++) {
+                line = "<row>";
+                # Columns in reverse order, the worst case for a linear search per column
+                for (c = ncols; c >= 1; c--) line = line "<c" c ">v" r "_" c "</c" c ">";
+                print line "</row>";
+            }
+            print "</table>";
+        }' > "$table_xml"
+        ;;
+    hugecell)
+        metadata_xml "" "$(column_xml id INTEGER; column_xml body "CLOB")" 1
+        units=$((scale * 256 * 1024 / ${#ESC_UNIT}))
+        awk -v units=$units -v unit="$ESC_UNIT" -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            printf "<row><c1>1</c1><c2>";
+            for (u = 0; u < units; u++) printf "%s", unit;
+            print "</c2></row>";
+            print "</table>";
+        }' > "$table_xml"
+        ;;
+    escapes)
+        rows=$((200 * scale))
+        metadata_xml "" "$(for c in 1 2 3 4; do column_xml t$c "VARCHAR(1024)"; done)" $rows
+        awk -v rows=$rows -v unit="$ESC_UNIT" -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            text = ""; for (u = 0; u < 6; u++) text = text unit;
+            for (r = 0; r < rows; r++) {
+                line = "<row>";
+                for (c = 1; c <= 4; c++) line = line "<c" c ">" r text "</c" c ">";
+                print line "</row>";
+            }
+            print "</table>";
+        }' > "$table_xml"
+        ;;
+    deep)
+        depth=$((12 * scale))
+        rows=40
+        if [ $depth -ge 500 ]; then
+            echo "Scale $scale too large for 'deep' (nesting limited to 500 levels)" >&2
+            exit 1
+        fi
+        types=$(
+            echo "<types>"
+            for ((d = 1; d <= depth; d++)); do
+                echo "<type><name>t$d</name><category>udt</category><attributes>"
+                echo "<attribute><name>id</name><type>INTEGER</type></attribute>"
+                echo "<attribute><name>label</name><type>VARCHAR(32)</type></attribute>"
+                [ $d -lt $depth ] && echo "<attribute><name>next</name><typeSchema>wc</typeSchema><typeName>t$((d + 1))</typeName></attribute>"
+                echo "</attributes></type>"
+            done
+            echo "</types>"
+        )
+        metadata_xml "$types" "$(column_xml id INTEGER; column_xml tree "wc:t1")" $rows
+        awk -v rows=$rows -v depth=$depth -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            for (r = 0; r < rows; r++) {
+                line = "<row><c1>" r "</c1><c2>";
+                for (d = 1; d <= depth; d++) {
+                    line = line "<u1>" d "</u1><u2>l" d "</u2>";
+                    if (d < depth) line = line "<u3>";
+                }
+                for (d = 1; d < depth; d++) line = line "</u3>";
+                print line "</c2></row>";
+            }
+            print "</table>";
+        }' > "$table_xml"
+        ;;
+    array)
+        card=$((500 * scale))
+        rows=10
+        metadata_xml "" "$(column_xml id INTEGER; column_xml items "VARCHAR(16)" $card)" $rows
+        awk -v rows=$rows -v card=$card -v ns="$NS_TABLE" 'BEGIN {
+            print "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+            print "<table xmlns=\"" ns "\" version=\"2.1\">";
+            for (r = 0; r < rows; r++) {
+                line = "<row><c1>" r "</c1><c2>";
+                # Every other element missing, as allowed for arrays
+                for (a = 1; a <= card; a += 2) line = line "<a" a ">e" a "</a" a ">";
+                print line "</c2></row>";
+            }
+            print "</table>";
+        }' > "$table_xml"
+        ;;
+    *)
+        echo "Unknown kind '$kind'" >&2
+        exit 1
+        ;;
+esac
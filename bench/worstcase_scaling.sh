@@ -0,0 +1,63 @@
+#!/bin/bash
+#
+#   siard2sql - A library to translate SIARD format
+#   to sqlite-compliant SQL
+#
+#   Immortal Database Access (iDA) EUROSTARS project
+#
+#   Eladio Gutierrez, Sergio Romero, Oscar Plata
+#   University of Malaga, Spain
+#
+#   Oct 2026
+#
+# Check that the conversion time grows linearly with the input size on the
+# worst-case corpus (see worstcase_corpus.sh): each kind of input is converted
+# at scale S and 4*S, and the check fails if the time grows more than
+# MAX_RATIO times (a linear algorithm gives ~4, a quadratic one ~16).
+#
+# Usage: worstcase_scaling.sh [siard2sql binary] [S]
+#
+# Exit status is non-zero if any kind of input scales super-linearly.
+
+BIN=${1:-run-linux/siard2sql}
+S=${2:-8}
+FACTOR=4
+MAX_RATIO=${MAX_RATIO:-7}
+KINDS=${KINDS:-"wide hugecell escapes deep array"}
+
+BENCHDIR=$(dirname "$0")
+TMP=$(mktemp -d /tmp/_s2s_wcXXXXXX)
+trap 'rm -rf "$TMP"' EXIT
+
+# Best of 3 runs, in milliseconds
+time_conversion() {
+    local best=
+    for k in 1 2 3; do
+        local t0=$(date +%s%N)
+        "$BIN" "$1" "$TMP/out.sql" > /dev/null 2>&1 || { echo "FAILED converting $1" >&2; return 1; }
+        local t1=$(date +%s%N)
+        local ms=$(( (t1 - t0) / 1000000 ))
+        [ -z "$best" ] || [ $ms -lt $best ] && best=$ms
+    done
+    echo $best
+}
+
+fail=0
+printf "%-10s %10s %10s %8s\n" kind "t(S) ms" "t(${FACTOR}S) ms" ratio
+for kind in $KINDS; do
+    "$BENCHDIR/worstcase_corpus.sh" "$TMP/small" $kind $S || exit 1
+    "$BENCHDIR/worstcase_corpus.sh" "$TMP/large" $kind $((FACTOR * S)) || exit 1
+    t1=$(time_conversion "$TMP/small") || exit 1
+    t2=$(time_conversion "$TMP/large") || exit 1
+    # Avoid dividing by tiny times, timer granularity dominates there
+    [ $t1 -lt 10 ] && t1=10
+    ratio=$(awk -v a=$t1 -v b=$t2 'BEGIN { printf "%.2f", b / a }')
+    status=ok
+    if awk -v r=$ratio -v m=$MAX_RATIO 'BEGIN { exit !(r > m) }'; then
+        status="SUPER-LINEAR"
+        fail=1
+    fi
+    printf "%-10s %10d %10d %8s  %s\n" $kind $t1 $t2 $ratio "$status"
+done
+
+exit $fail
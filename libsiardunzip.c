@@ -16,9 +16,21 @@
 #include <dirent.h>
 #include <libgen.h>
 
+#include "siard2sql.h"
+
 // Functions to extract zip files defined in thirdparty/zlib/contrib/minizip/miniunz.c
 extern int IDA_miniunz_do_unzip(const char *zipfilename, char *filename);
+extern char* IDA_miniunz_do_unzip_to_buffer(const char *zipfilename, char* filename, long *size_buf);
 extern void IDA_minunz_close_all_open_zip();
+extern int IDA_miniunz_list_entries(const char *zipfilename, const char *prefix,
+                                    void (*cb)(const char *name, long size, void *arg), void *arg);
+extern void IDA_miniunz_set_inflate_threads(int nthreads);
+// Rewriting zips, see thirdparty/zlib/contrib/minizip/ida_minizip.c
+extern int IDA_minizip_repack(const char *zipin, const char *zipout, const char **order, long norder,
+                              long block_size, int store_incompressible);
+// Zips in memory, see thirdparty/zlib/contrib/minizip/ida_miniunz_utils.cpp
+extern void IDA_ZIP_add_memory_zip(const char *zipname, const void *buf, long size);
+extern void IDA_ZIP_remove_memory_zip(const char *zipname);
 
 // Unzip a (SIARD) zip file (see miniunz.c)
 // If filename != NULL, only this particular file is extracted,
@@ -28,6 +40,50 @@ int IDA_unzip(const char* siardfile, char *filename)
     return IDA_miniunz_do_unzip(siardfile, filename);
 }
 
+// Extract only one file of a zip into a buffer allocated with malloc() (to be released
+// by the caller), setting its size; return NULL if error
+char* IDA_unzip_to_buffer(const char* siardfile, char *filename, long *size)
+{
+    return IDA_miniunz_do_unzip_to_buffer(siardfile, filename, size);
+}
+
+// Call cb(name, size, arg) for each file of a zip whose name starts with prefix, in the
+// order they are stored in the archive; size is the uncompressed size
+// Return 0 if OK, or an error code otherwise
+int IDA_unzip_list_entries(const char* siardfile, const char *prefix, IDA_unzip_entry_cb cb, void *arg)
+{
+    return IDA_miniunz_list_entries(siardfile, prefix, cb, arg);
+}
+
+// Inflate large zip entries with up to nthreads threads (0 or 1: sequentially)
+void IDA_unzip_set_inflate_threads(int nthreads)
+{
+    IDA_miniunz_set_inflate_threads(nthreads);
+}
+
+// Write a copy of a zip file with the entries named in order[0..norder-1] first, then the rest
+// in their original order; deflated ".xml" entries larger than two blocks are deflated again in
+// restartable blocks of block_size bytes (if > 0), with a seek index, and, if store_incompressible,
+// entries not compressed by deflate are stored (see ida_minizip.c)
+// Return 0 if OK, or an error code otherwise
+int IDA_unzip_repack(const char* siardfile, const char *siardout, const char **order, long norder,
+                     long block_size, int store_incompressible)
+{
+    return IDA_minizip_repack(siardfile, siardout, order, norder, block_size, store_incompressible);
+}
+
+// Register a zip archive held in memory with a name, so that the functions above can unzip it
+// using that name as its path, with no filesystem access (the buffer must outlive its use)
+void IDA_unzip_add_memory_zip(const char* name, const void *buf, long size)
+{
+    IDA_ZIP_add_memory_zip(name, buf, size);
+}
+
+void IDA_unzip_remove_memory_zip(const char* name)
+{
+    IDA_ZIP_remove_memory_zip(name);
+}
+
 // Unzip a SIARD file (see miniunz.c)
 int IDA_unzip_siard_full(const char* siardfile)
 {
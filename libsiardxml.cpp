@@ -23,9 +23,18 @@
 #include <queue>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <regex>
 #include <iterator>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#ifndef __ivm64__
+#include <thread>
+#include <mutex>
+#include <system_error>
+#endif
 
 #include <cstdio>
 #include <cstdarg>
@@ -42,10 +51,29 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <libgen.h>
+#include <strings.h>
 #include <cassert>
+#ifndef __ivm64__
+#include <sys/uio.h>
+#include <climits>
+#endif
+
+// Sampling profiler (see IDA_profiler), where signals, timers and stack unwinding exist
+#if !defined(__ivm64__) && defined(__has_include)
+#if __has_include(<execinfo.h>) && __has_include(<dlfcn.h>) && __has_include(<cxxabi.h>)
+#include <csignal>
+#include <sys/time.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#define IDA_PROFILER_ENABLED 1
+#endif
+#endif
 
 #include "tinyxml2.h"
 #include "siard2sql.h"
+#include "ida_probes.h"
+#include "ida_log.h"
 
 #if !defined(_GNU_SOURCE)
 extern "C" char *strcasestr(const char*, const char *);
@@ -70,6 +98,196 @@ namespace IDA {
 
     static long dbgc1=0; // Debug, a counter used to print some messages
 
+    // Incremental digest of a LOB file, to verify the SIARD attributes digestType/digest
+    // of a LOB while its bytes are converted to hex (no extra reads of the file)
+    // Supported digest types: MD5, SHA-1 and SHA-256
+    class IDA_digest {
+    public:
+        enum digest_e {NONE, MD5, SHA1, SHA256};
+
+        static long mismatches; // Number of mismatches found in the running conversion
+
+        // A NONE digest (unknown type or no expected digest) does nothing
+        IDA_digest(const string &digest_type = "", const string &expected = "", const string &name = "")
+        {
+            type = NONE;
+            if (!expected.empty()) {
+                if (!strcasecmp(digest_type.c_str(), "MD5")) type = MD5;
+                else if (!strcasecmp(digest_type.c_str(), "SHA-1") || !strcasecmp(digest_type.c_str(), "SHA1")) type = SHA1;
+                else if (!strcasecmp(digest_type.c_str(), "SHA-256") || !strcasecmp(digest_type.c_str(), "SHA256")) type = SHA256;
+            }
+            this->expected = expected;
+            this->digest_type = digest_type;
+            this->name = name;
+            static const uint32_t h_md5[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+            static const uint32_t h_sha1[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+            static const uint32_t h_sha256[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            if (type == MD5) memcpy(h, h_md5, sizeof(h_md5));
+            if (type == SHA1) memcpy(h, h_sha1, sizeof(h_sha1));
+            if (type == SHA256) memcpy(h, h_sha256, sizeof(h_sha256));
+        }
+
+        bool enabled() const { return type != NONE; }
+
+        void update(const uint8_t *p, size_t n)
+        {
+            if (type == NONE) return;
+            length += n;
+            if (nblock) {
+                size_t k = std::min(n, (size_t)64 - nblock);
+                memcpy(block + nblock, p, k);
+                nblock += k; p += k; n -= k;
+                if (nblock < 64) return;
+                process(block);
+                nblock = 0;
+            }
+            for (; n >= 64; p += 64, n -= 64) process(p);
+            memcpy(block, p, n);
+            nblock = n;
+        }
+
+        // Finish and return the digest in hexadecimal (lowercase)
+        string hexdigest()
+        {
+            uint64_t bits = length * 8;
+            uint8_t pad[72] = {0x80};
+            size_t npad = (nblock < 56 ? 56 : 120) - nblock;
+            for (int k = 0; k < 8; k++) {
+                // Length in bits: little endian for MD5, big endian for SHA
+                pad[npad + k] = (uint8_t)(type == MD5 ? bits >> (8 * k) : bits >> (56 - 8 * k));
+            }
+            update(pad, npad + 8);
+            int nwords = (type == MD5) ? 4 : (type == SHA1) ? 5 : 8;
+            static const char hexdigits[] = "0123456789abcdef";
+            string d;
+            for (int w = 0; w < nwords; w++) {
+                for (int k = 0; k < 4; k++) {
+                    uint8_t b = (uint8_t)(type == MD5 ? h[w] >> (8 * k) : h[w] >> (24 - 8 * k));
+                    d.push_back(hexdigits[b >> 4]);
+                    d.push_back(hexdigits[b & 0xf]);
+                }
+            }
+            return d;
+        }
+
+        // Finish and compare with the expected digest, reporting a mismatch
+        // Return true if they match (or if there is nothing to verify)
+        bool verify(const string &tablename)
+        {
+            if (type == NONE) return true;
+            string computed = hexdigest();
+            type = NONE;
+            if (!strcasecmp(computed.c_str(), expected.c_str())) return true;
+            mismatches++;
+            IDA_log(IDA_LOG_WARNING, "Digest mismatch in table '%s', LOB file '%s': %s %s expected, %s computed",
+                    tablename.c_str(), name.c_str(), digest_type.c_str(), expected.c_str(), computed.c_str());
+            return false;
+        }
+
+    private:
+        digest_e type;
+        string expected, digest_type, name;
+        uint32_t h[8];
+        uint8_t block[64];
+        size_t nblock = 0;   // Bytes pending in block
+        uint64_t length = 0; // Total bytes
+
+        static uint32_t rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+        static uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+        static uint32_t load_le(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+        static uint32_t load_be(const uint8_t *p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+        void process(const uint8_t *p)
+        {
+            if (type == MD5) md5_block(p);
+            else if (type == SHA1) sha1_block(p);
+            else sha256_block(p);
+        }
+
+        void md5_block(const uint8_t *p)
+        {
+            static const uint32_t K[64] = {
+                0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+                0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+                0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+                0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+                0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+                0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+                0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+                0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+            static const int R[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+            uint32_t M[16];
+            for (int i = 0; i < 16; i++) M[i] = load_le(p + 4 * i);
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+            for (int i = 0; i < 64; i++) {
+                uint32_t f;
+                int g;
+                if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+                else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+                else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) & 15; }
+                else             { f = c ^ (b | ~d);       g = (7 * i) & 15; }
+                uint32_t t = d;
+                d = c;
+                c = b;
+                b = b + rotl(a + f + K[i] + M[g], R[(i >> 4) * 4 + (i & 3)]);
+                a = t;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+        }
+
+        void sha1_block(const uint8_t *p)
+        {
+            uint32_t W[80];
+            for (int i = 0; i < 16; i++) W[i] = load_be(p + 4 * i);
+            for (int i = 16; i < 80; i++) W[i] = rotl(W[i-3] ^ W[i-8] ^ W[i-14] ^ W[i-16], 1);
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; i++) {
+                uint32_t f, k;
+                if (i < 20)      { f = (b & c) | (~b & d);          k = 0x5a827999; }
+                else if (i < 40) { f = b ^ c ^ d;                   k = 0x6ed9eba1; }
+                else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc; }
+                else             { f = b ^ c ^ d;                   k = 0xca62c1d6; }
+                uint32_t t = rotl(a, 5) + f + e + k + W[i];
+                e = d;
+                d = c;
+                c = rotl(b, 30);
+                b = a;
+                a = t;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+        }
+
+        void sha256_block(const uint8_t *p)
+        {
+            static const uint32_t K[64] = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+            uint32_t W[64];
+            for (int i = 0; i < 16; i++) W[i] = load_be(p + 4 * i);
+            for (int i = 16; i < 64; i++) {
+                uint32_t s0 = rotr(W[i-15], 7) ^ rotr(W[i-15], 18) ^ (W[i-15] >> 3);
+                uint32_t s1 = rotr(W[i-2], 17) ^ rotr(W[i-2], 19) ^ (W[i-2] >> 10);
+                W[i] = W[i-16] + s0 + W[i-7] + s1;
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+            for (int i = 0; i < 64; i++) {
+                uint32_t t1 = hh + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + W[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                hh = g; g = f; f = e; e = d + t1;
+                d = c; c = b; b = a; a = t1 + t2;
+            }
+            h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+        }
+    };
+    long IDA_digest::mismatches = 0;
+
     // Some useful methods to use when parsing siard format
     class IDA_siard_utils{
     public:
@@ -181,6 +399,81 @@ namespace IDA {
             return ret;
         }
 
+        // Return true if the SIARD type is an exact integer type (BIGINT, INTEGER, INT, SMALLINT),
+        // whose values can be stored in a sqlite3 rowid; BOOLEAN is excluded although it has
+        // INTEGER affinity
+        static bool is_siard_exact_integer(const string &s)
+        {
+            static regex re_bool("BOOL");
+            return siard_type_to_sqlite3(s) == COLTYPE_INTEGER && !regex_search(s, re_bool);
+        }
+
+        // Return true if the SIARD type is a large object (BLOB, CLOB, NCLOB, XML)
+        static bool is_siard_lob(const string &s)
+        {
+            static regex re_lob(R"(LARGE OBJECT|LOB|XML)");
+            return regex_search(s, re_lob);
+        }
+
+        // Classify a SIARD type to order the columns physically in a record:
+        //   0: fixed-size numbers, 1: bounded strings, 2: unbounded strings, 3: LOBs and complex types
+        static int siard_type_storage_class(const string &s, bool complex_type = false)
+        {
+            if (complex_type || is_siard_lob(s)) {
+                return 3;
+            }
+            switch (siard_type_to_sqlite3(s)) {
+                case COLTYPE_INTEGER:
+                case COLTYPE_REAL:
+                case COLTYPE_NUMERIC:
+                    return 0;
+                default:
+                    break;
+            }
+            return (estimate_siard_type_width(s) >= 0) ? 1 : 2;
+        }
+
+        // Quote a sqlite3 identifier with double quotes, escaping the existing ones
+        static string quote_sqlite_identifier(const string &s)
+        {
+            string q = "\"";
+            for (char c: s) {
+                if (c == '"') q += '"';
+                q += c;
+            }
+            return q + "\"";
+        }
+
+        // Estimate the maximum size in bytes of a value of a SIARD simple type, used
+        // to decide whether a table is narrow; return -1 if it is not bounded
+        // (LOBs, or strings with no length)
+        static long estimate_siard_type_width(const string &s)
+        {
+            static regex re_len(R"(\(\s*([0-9]+))");
+            static regex re_date(R"(DATE|TIME|INTERVAL)");
+            smatch m;
+
+            if (is_siard_lob(s)) {
+                return -1;
+            }
+            switch (siard_type_to_sqlite3(s)) {
+                case COLTYPE_INTEGER:
+                case COLTYPE_REAL:
+                    return 8;
+                case COLTYPE_NUMERIC:
+                    return 16;
+                default:
+                    break;
+            }
+            if (regex_search(s, m, re_len)) {
+                return stol(m[1].str());
+            }
+            if (regex_search(s, re_date)) {
+                return 32; // ISO 8601 text representation
+            }
+            return -1;
+        }
+
         // Convert a string to a sqlite3 BLOB hex literal
         // "SOS" -> "X'534f53'"
         static string string_to_blob_literal(const string &s)
@@ -210,16 +503,21 @@ namespace IDA {
         }
 
         // Convert a uint_8 array (may include NULLs) to a sqlite3 BLOB hex literal
-        // appending it to the string a
+        // appending it to the string a; the bytes are added to the digest d, if any
         // "SOS\0" -> "X'534f5300'"
-        static void char_array_to_blob_literal_append(const uint8_t *a, unsigned long size, string &s)
+        static void char_array_to_blob_literal_append(const uint8_t *a, unsigned long size, string &s,
+                                                      IDA_digest *d = NULL)
         {
+            static const char hexdigits[] = "0123456789abcdef";
             s.append("X'");
             if (a) {
+                if (d) d->update(a, size);
+                // Whole LOBs may come this way (memory mode), avoid sprintf per byte
+                size_t pos = s.size();
+                s.resize(pos + 2 * size);
                 for (unsigned long k = 0; k < size; k++) {
-                    char uu[3];
-                    sprintf(uu, "%02x", (uint8_t)a[k]);
-                    s.append(uu);
+                    s[pos++] = hexdigits[a[k] >> 4];
+                    s[pos++] = hexdigits[a[k] & 0xf];
                 }
             }
             s.append("'");
@@ -257,19 +555,48 @@ namespace IDA {
         // Convert the content of a file to a sqlite3 BLOB hex literal
         // appending it to the string s
         // "SOS" -> "X'534f53'"
-        static void file_to_blob_literal_append(const string &file, string &s)
+        static long file_to_blob_literal_append(const string &file, string &s, IDA_digest *d = NULL)
+        {
+            return file_chunk_to_blob_literal_append(file, s, 0, -1, d);
+        }
+
+        // Convert at most 'maxsize' bytes of a file, starting at 'offset', to a sqlite3 BLOB hex
+        // literal appending it to the string s; if maxsize < 0 the file is read until its end
+        // The bytes read are added to the digest d, if any
+        // Return the number of bytes converted
+        static long file_chunk_to_blob_literal_append(const string &file, string &s, long offset, long maxsize,
+                                                      IDA_digest *d = NULL)
         {
-            unsigned char buf[FILE_BLOB_BUFF_SIZE]; // This MUST be unsigned
             FILE *f = fopen(file.c_str(), "r");
             if (!f) {
                 cerr << "Error: opening '" << file << "' (notice: perhaps external file)" << endl;
                 s.append("X''");
-                return;
+                return 0;
+            }
+            if (offset > 0 && fseek(f, offset, SEEK_SET)) {
+                cerr << "Error: seeking offset " << offset << " of '" << file << "'" << endl;
+                fclose(f);
+                s.append("X''");
+                return 0;
             }
+            long total = stream_to_blob_literal_append(f, s, maxsize, d);
+            fclose(f);
+            return total;
+        }
+
+        // Convert at most 'maxsize' bytes read from an open file to a sqlite3 BLOB hex
+        // literal appending it to the string s; if maxsize < 0 the file is read until its end
+        // The bytes read are added to the digest d, if any
+        // Return the number of bytes converted
+        static long stream_to_blob_literal_append(FILE *f, string &s, long maxsize, IDA_digest *d = NULL)
+        {
+            unsigned char buf[FILE_BLOB_BUFF_SIZE]; // This MUST be unsigned
             s.append("X'");
-            long n, n4;
-            std::ostringstream ss;
-            while ((n = fread(buf, 1, FILE_BLOB_BUFF_SIZE, f )) > 0) {
+            long n, n4, total = 0;
+            while ((maxsize < 0 || total < maxsize)
+                   && (n = fread(buf, 1, (maxsize < 0) ? FILE_BLOB_BUFF_SIZE : std::min((long)FILE_BLOB_BUFF_SIZE, maxsize - total), f )) > 0) {
+                total += n;
+                if (d) d->update(buf, n);
                 n4 = n/4;
                 for (long k=0; k<n4; k++){
                     char uu[2*4+1];
@@ -293,17 +620,24 @@ namespace IDA {
                 //-- s.append(ss.str());
                 //-- FREE_ALLOCA();
             }
-            fclose(f);
             s.append("'");
+            return total;
         }
 
         // Enclose string in single quotes by escaping
         // the existing single quotes, in order to use the
         // input string in sqlite
         // Escaping ' in sqlite is doubling it: ''
-        static string enclose_sqlite_single_quote(string s){
-            static regex e("'");
-            return "'" + regex_replace(s, e, "''") + "'";
+        static string enclose_sqlite_single_quote(const string &s){
+            string q;
+            q.reserve(s.size() + 2);
+            q.push_back('\'');
+            for (char c : s) {
+                q.push_back(c);
+                if (c == '\'') q.push_back('\'');
+            }
+            q.push_back('\'');
+            return q;
         }
 
         #define siard_special(s) (!strncmp(s, "\\u00", 4))
@@ -311,15 +645,8 @@ namespace IDA {
         //  Return true if a SIARD coded string has "special" chars, of the form \u005c,
         //  and consequently it needs to be decoded
         static bool has_siard_special_chars(const string &siard_str){
-            bool has_specials = false;
-            const char *s_encod = siard_str.c_str();
-            for (unsigned long i = 0; i < strlen(s_encod); i++) {
-                if (siard_special(&s_encod[i])) {
-                    has_specials = true;
-                    break;
-                }
-            }
-            return has_specials;
+            size_t p = siard_str.find("\\u00");
+            return p != string::npos && p + 5 < siard_str.size(); // A complete \u00xx
         }
 
         //  Decode a SIARD coded string allocating the decoded form in an
@@ -357,10 +684,11 @@ namespace IDA {
                 return NULL;
             }
             const char *s_encod = siard_str.c_str();
-            uint8_t *s_decod = (uint8_t*) malloc(strlen(s_encod) * sizeof(char));
+            unsigned long len = strlen(s_encod); // Not in the loop condition: it would be quadratic
+            uint8_t *s_decod = (uint8_t*) malloc(len * sizeof(char));
             if (s_decod) {
-                for (unsigned long i = 0; i < strlen(s_encod); i++) {
-                    if (siard_special(&s_encod[i])) {
+                for (unsigned long i = 0; i < len; i++) {
+                    if (i + 5 < len && siard_special(&s_encod[i])) {
                         has_specials = true;
                         char hex[5] = {s_encod[i + 2], s_encod[i + 3], s_encod[i + 4], s_encod[i + 5], '\0'};
                         unsigned char val = strtol(hex, NULL, 16);
@@ -809,8 +1137,8 @@ namespace IDA {
         // Delete a file only if it is placed in a given directory (supposedly temporary)
         static void delete_temp_file(const string &tmpdir, const string &filename)
         {
-            if (IDA_parsing_utils::is_prefix(tmpdir, get_canonical_file_name(filename))) {
-                fprintf(stdout, " ... deleting temporary file '%s'\n", filename.c_str());
+            if (!tmpdir.empty() && IDA_parsing_utils::is_prefix(tmpdir,get_canonical_file_name(filename))) {
+                IDA_log(IDA_LOG_DEBUG, " ... deleting temporary file '%s'", filename.c_str());
                 ::unlink(filename.c_str());
             }
         }
@@ -904,6 +1232,23 @@ namespace IDA {
 
         }
 
+        // Extract a path of the form '<zipname>/path/to/file' from the zip archive
+        // 'zipname' to a malloc'ed buffer (to be freed by the caller), whose size is
+        // returned in 'size'; this is the counterpart of unzipURI() when the archive
+        // is held in memory (see IDA_unzip_add_memory_zip()).
+        // Zips nested inside the archive are not supported.
+        // Return NULL if not possible to extract
+        static char *unzip_memory_entry(const string &zipname, const string &path, long &size)
+        {
+            size = 0;
+            string z = get_canonical_file_name(path);
+            if (!IDA_parsing_utils::is_prefix(zipname + "/", z)) {
+                return NULL;
+            }
+            string entry = z.substr(zipname.size() + 1);
+            return IDA_unzip_to_buffer(zipname.c_str(), (char*)entry.c_str(), &size);
+        }
+
     }; /* class IDA_file_utils */
     stack<string> IDA_file_utils::dirstack = {};
 
@@ -993,20 +1338,20 @@ namespace IDA {
         static XMLElement* breadth_first_search_element_by_tag(XMLElement *pElem, const string &tagname)
         {
             if (pElem){
-                vector<XMLElement*> v;
+                queue<XMLElement*> v; // Popping from the front of a vector would be quadratic
                 for (XMLElement *pe=pElem->FirstChildElement(); pe; pe = pe->NextSiblingElement()) {
-                    v.push_back(pe);
+                    v.push(pe);
                 }
 
                 while (!v.empty()) {
-                    XMLElement *pe = v[0];
+                    XMLElement *pe = v.front();
                     if (!tagname.compare(pe->Name())) {
                         return pe;
                     }
                     for (XMLElement *ce = pe->FirstChildElement(); ce; ce = ce->NextSiblingElement()) {
-                        v.push_back(ce);
+                        v.push(ce);
                     }
-                    v.erase(v.begin());
+                    v.pop();
                 }
             }
             return NULL;
@@ -1079,6 +1424,25 @@ namespace IDA {
             return "";
         }
 
+        // Index the immediate children of an element by tag name (the first one if repeated)
+        static void index_children_by_tag(XMLElement *pElem, unordered_map<string, XMLElement*> &children)
+        {
+            children.clear();
+            if (pElem) {
+                for (XMLElement *pe=pElem->FirstChildElement(); pe; pe = pe->NextSiblingElement()) {
+                    children.emplace(pe->Name(), pe);
+                }
+            }
+        }
+
+        // Look up a tag in an index built by index_children_by_tag(); NULL if not found
+        static XMLElement* find_indexed_child_by_tag(const unordered_map<string, XMLElement*> &children,
+                                                     const string &tagname)
+        {
+            auto it = children.find(tagname);
+            return (it != children.end()) ? it->second : NULL;
+        }
+
         // Build an array will all elements found matching the tag name
         static void breadth_first_search_elements_by_tag(XMLElement *pElem, const string &tagname,
                                                          vector<XMLElement*> &elements, long maxdepth=9)
@@ -1710,117 +2074,718 @@ namespace IDA {
         return out;
     }
 
-    // Two possibilities: unzip the zip fully, or unzipping file by file
-    enum unzipmode_e {SIARD_FULL_UNZIP, SIARD_FILE_BY_FILE_UNZIP};
+    // Maximum estimated row size (bytes) for a table to be considered narrow, and
+    // then created WITHOUT ROWID in the storage optimization mode (about 1/20 of
+    // the default 4KB sqlite3 page, as recommended by sqlite3 documentation)
+    #define IDA_NARROW_ROW_SIZE 200
 
-    // Main class to process  "content/schema<M>/table<N>/table<N>.xml" archive
-    class IDA_SIARDcontent{
-        XMLDocument doc;
-        XMLElement *pRootElem = NULL;
+    // Minimum size (bytes) of a LOB chunk in the chunked LOB mode; it must be larger
+    // than IDA_NARROW_ROW_SIZE so that WITHOUT ROWID tables never need chunks
+    #define IDA_LOB_CHUNK_MIN_SIZE 1024
 
-        string tablename;
+    // Suffix of the name of a table whose columns are physically reordered (option lobs_last);
+    // a view with the original name of the table is created on it
+    #define IDA_PHYSICAL_TABLE_SUFFIX "__physical"
 
-        string siardURI;
-        string tmpdir;
-        enum unzipmode_e unzipmode;
+    // Maximum indentation (levels) of the json expressions of nested complex types
+    #define IDA_JSON_MAX_INDENT 32
 
-        ostream &sqlout = cout;
-        unsigned long ncols = 0;
-        vector<string> siard_colname_v;
-        vector<IDA_SIARD_type_attribute> siard_coltype_v;
-        vector<IDA_SIARDlobfolder> siard_lobfolder_info_v;
+    // Thrown at a cancellation point of a conversion whose cancellation was requested
+    class IDA_cancelled : public exception {
+    public:
+        const char* what() const noexcept override { return "conversion cancelled"; }
+    };
 
+    // Cancellation points of the running conversion (between tables, rows and LOB chunks)
+    // A cancelled conversion unwinds with IDA_cancelled up to IDA_SIARDmetadata::tree_to_sql(),
+    // and the temporary directory is removed when the IDA_SIARDmetadata object is destroyed
+    class IDA_cancellation {
+        static const atomic<int> *flag; // Flag of the running conversion, NULL if not cancellable
     public:
-        unsigned long current_col_id = 0;
-        IDA_SIARDcontent(const string& tablename,
-                         const string& siardURI, const string& tmpdir, enum unzipmode_e unzipmode,
-                         ostream &sqlout, unsigned long ncols,
-                         vector<string> siard_colname_v,
-                         vector<IDA_SIARD_type_attribute> siard_coltype_v,
-                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v)
-                         :
-                tablename(tablename), siardURI(siardURI), tmpdir(tmpdir),
-                sqlout(sqlout), ncols(ncols),
-                siard_colname_v(siard_colname_v),
-                siard_coltype_v(siard_coltype_v), siard_lobfolder_info_v(siard_lobfolder_info_v)
+        static void set_flag(const atomic<int> *f) { flag = f; }
+        static bool requested() { return flag && flag->load(memory_order_relaxed); }
+        static void check() { if (requested()) throw IDA_cancelled(); }
+    };
+    const atomic<int> *IDA_cancellation::flag = NULL;
+
+    // Time spent by the running conversion in each stage, reported at level IDA_LOG_INFO:
+    // inflating zip entries, parsing XML and writing SQL; the rest of the time is encoding
+    // (decoding SIARD values and building SQL statements). A scope object adds its lifetime
+    // to a stage; it costs nothing if the stage times are not enabled
+    class IDA_stage_times {
+    public:
+        enum stage_e {INFLATE, PARSE, WRITE, NSTAGES};
+
+        class scope {
+            stage_e stage;
+            chrono::steady_clock::time_point t0;
+        public:
+            scope(stage_e stage) : stage(stage) { if (enabled) t0 = chrono::steady_clock::now(); }
+            ~scope() { if (enabled) ms[stage] += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count(); }
+        };
+
+        static void start()
         {
-            this->unzipmode = unzipmode;
-            clear();
+            enabled = IDA_log_enabled(IDA_LOG_INFO);
+            for (int k = 0; k < NSTAGES; k++) ms[k] = 0;
+            t_start = chrono::steady_clock::now();
         }
 
-        void clear()
+        static void report()
         {
-            doc.Clear();
-            pRootElem = NULL;
+            if (!enabled) return;
+            double total = chrono::duration<double, milli>(chrono::steady_clock::now() - t_start).count();
+            IDA_log(IDA_LOG_INFO, "Stage times (ms): inflate %.1f parse %.1f encode %.1f write %.1f total %.1f",
+                    ms[INFLATE], ms[PARSE], total - ms[INFLATE] - ms[PARSE] - ms[WRITE], ms[WRITE], total);
+            enabled = false;
         }
 
-        int load(const char *xmlfile)
+    private:
+        static bool enabled;
+        static double ms[NSTAGES];
+        static chrono::steady_clock::time_point t_start;
+    };
+    bool IDA_stage_times::enabled = false;
+    double IDA_stage_times::ms[IDA_stage_times::NSTAGES];
+    chrono::steady_clock::time_point IDA_stage_times::t_start;
+
+    // Sampling profiler (option profile_rate): a SIGPROF timer samples the stack of the thread
+    // running, profile_rate times per second of CPU time, and at the end of the conversion the
+    // samples are written as folded stacks (one line per distinct stack with its number of
+    // samples, the input of flamegraph.pl), rooted at the schema/table being converted:
+    //
+    //   sakila/film;main;IDA_siard2sql_opt;...;IDA::IDA_SIARDcontent::tree_to_sql;... 12
+    //
+    // ("-" outside tables). The signal handler only stores the return addresses into a
+    // preallocated array (samples beyond its size are counted but dropped); they are
+    // symbolized at the end with dladdr(), so functions not exported appear as module+offset
+    // (link the binary with -rdynamic). The previous SIGPROF handler and timer are restored.
+    // Not available on ivm64.
+    class IDA_profiler {
+    public:
+        // Attribute the next samples to a table (or to none, with empty names)
+        static void set_context(const string &schema, const string &table)
         {
-            clear();
-            XMLError result = XML_ERROR_FILE_READ_ERROR;
+#ifdef IDA_PROFILER_ENABLED
+            if (!active) return;
+            if (schema.empty() && table.empty()) {
+                context.store(0, memory_order_relaxed);
+                return;
+            }
+            string c = schema + '/' + table;
+            replace_if(c.begin(), c.end(), [](char ch) { return ch == ';' || ch == '\n' || ch == '\r'; }, '_');
+            contexts.push_back(c);
+            context.store(contexts.size() - 1, memory_order_relaxed);
+#endif
+        }
 
-            try {
-                result = doc.LoadFile(xmlfile);
-            } catch (const std::exception &e) {
-                // catch anything thrown within try block that derives from std::exception
-                cerr << "*EXCEPTION loading XML '" << xmlfile << "'" << endl << " what: '" << e.what() << "'" << endl;
-                result = XML_ERROR_FILE_READ_ERROR;
-                //- exit(126);
-            } catch (...){
-                cerr << "*Unknown EXCEPTION loading XML '" << xmlfile << "' result=" << result << "" << endl;
-                result = XML_ERROR_FILE_READ_ERROR;
-                //- exit(127);
+        // Profile a conversion while in scope, writing the folded stacks to a file at the end
+        class session {
+            string filename;
+        public:
+            session(int rate, const string &filename) : filename(filename)
+            {
+                if (rate > 0 && !start(rate)) {
+                    IDA_log(IDA_LOG_WARNING, "Sampling profiler not available");
+                }
             }
+            ~session() { stop(filename); }
+        };
 
-            if (result != XML_SUCCESS){
-                //fprintf(stderr, "Error loading XML file '%s': %d\n", xmlfile, result); // Debug
-                return -1;
-            } else {
-                //fprintf(stderr, "OK loading '%s'\n", xmlfile); // Debug
-                pRootElem = doc.RootElement();
-                // Let us store also the filename
-                // -- xmlfilename = xmlfile;
-                return 0;
+    private:
+#ifdef IDA_PROFILER_ENABLED
+        static const int MAX_DEPTH = 48;
+        static const long MAX_SAMPLES = 1L << 16;
+        struct sample {
+            void *pc[MAX_DEPTH];
+            int depth;
+            int context;
+        };
+        static sample *samples;
+        static atomic<long> nsamples;
+        static atomic<int> context;       // Index in contexts of the current table
+        static vector<string> contexts;
+        static bool active;
+        static struct sigaction old_action;
+        static struct itimerval old_timer;
+
+        static void handler(int)
+        {
+            int saved_errno = errno;
+            long i = nsamples.fetch_add(1, memory_order_relaxed);
+            if (i < MAX_SAMPLES) {
+                samples[i].context = context.load(memory_order_relaxed);
+                samples[i].depth = backtrace(samples[i].pc, MAX_DEPTH);
             }
+            errno = saved_errno;
         }
 
-        int load(string xmlfile)
+        static string symbol_name(void *pc)
         {
-            return load(xmlfile.c_str());
+            Dl_info info;
+            if (!dladdr(pc, &info)) {
+                char buf[32];
+                snprintf(buf, sizeof(buf), "%p", pc);
+                return buf;
+            }
+            if (!info.dli_sname) {
+                const char *module = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+                char buf[32];
+                snprintf(buf, sizeof(buf), "+0x%lx", (unsigned long) ((char*) pc - (char*) info.dli_fbase));
+                return string(module ? module + 1 : info.dli_fname ? info.dli_fname : "?") + buf;
+            }
+            int status;
+            char *demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+            string name = (demangled && !status) ? demangled : info.dli_sname;
+            free(demangled);
+            size_t p = name.find('(');  // Without the parameter list
+            if (p != string::npos && p > 0) name.resize(p);
+            return name;
         }
+#endif
 
-        // Method to print one xml element, to be used
-        // in IDA_xml_utils::process_tree
-        static void print_element(XMLElement *pElem, string path, long level, va_list va)
+        static bool start(int rate)
         {
-            (void) path;
-            (void) va;
-            if (pElem) {
-                const char *elemName = pElem->Name();
-                const char *elemText = pElem->GetText();
-                if (!elemText) elemText = ""; // This element has no string
-                string indent(level, ' '); // Indent with spaces
-                cout << setw(4) << level << "> " << indent << "tagname='" << elemName << "' text='"
-                     << IDA_parsing_utils::trim(elemText) << "'" << " path=" << path << endl;
+#ifdef IDA_PROFILER_ENABLED
+            if (active) return false;
+            samples = new (nothrow) sample[MAX_SAMPLES];
+            if (!samples) return false;
+            void *pc[1];
+            backtrace(pc, 1); // The first call loads the unwinder, not to be done in the signal handler
+            nsamples.store(0);
+            contexts.assign(1, "-");
+            context.store(0);
+
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = handler;
+            sa.sa_flags = SA_RESTART;
+            sigemptyset(&sa.sa_mask);
+            long usec = max(1L, 1000000L / rate);
+            struct itimerval timer;
+            timer.it_interval.tv_sec = usec / 1000000;
+            timer.it_interval.tv_usec = usec % 1000000;
+            timer.it_value = timer.it_interval;
+            if (sigaction(SIGPROF, &sa, &old_action)) {
+                delete[] samples;
+                samples = NULL;
+                return false;
+            }
+            if (setitimer(ITIMER_PROF, &timer, &old_timer)) {
+                sigaction(SIGPROF, &old_action, NULL);
+                delete[] samples;
+                samples = NULL;
+                return false;
             }
+            active = true;
+            return true;
+#else
+            return false;
+#endif
         }
 
-        // Print raw
-        void print_tree(){
-            if (pRootElem) {
-                IDA_xml_utils::print_tree(pRootElem);
+        static void stop(const string &filename)
+        {
+#ifdef IDA_PROFILER_ENABLED
+            if (!active) return;
+            setitimer(ITIMER_PROF, &old_timer, NULL);
+            // A SIGPROF still pending must not terminate the process
+            struct sigaction restore = old_action;
+            if (restore.sa_handler == SIG_DFL && !old_timer.it_value.tv_sec && !old_timer.it_value.tv_usec) {
+                restore.sa_handler = SIG_IGN;
+            }
+            sigaction(SIGPROF, &restore, NULL);
+            active = false;
+
+            // Fold the samples: frames from the outermost one, after the signal handler frames
+            long n = min(nsamples.load(), MAX_SAMPLES);
+            unordered_map<void*, string> names;
+            map<string, long> folded;
+            for (long i = 0; i < n; i++) {
+                sample &s = samples[i];
+                int first = 2; // Skip the handler and the signal trampoline
+                string stack = contexts[s.context];
+                for (int k = s.depth - 1; k >= first; k--) {
+                    // Return addresses point after the call, but the interrupted one
+                    void *pc = (k > first) ? (char*) s.pc[k] - 1 : s.pc[k];
+                    auto it = names.find(pc);
+                    if (it == names.end()) it = names.insert(make_pair(pc, symbol_name(pc))).first;
+                    stack += ';' + it->second;
+                }
+                folded[stack]++;
             }
+            delete[] samples;
+            samples = NULL;
+
+            ofstream out(filename.c_str());
+            for (auto &f: folded) out << f.first << ' ' << f.second << '\n';
+            out.close();
+            if (!out) {
+                IDA_log(IDA_LOG_ERROR, "Error writing profile '%s'", filename.c_str());
+            } else {
+                IDA_log(IDA_LOG_INFO, "Profile: %ld samples (%ld dropped) written to '%s'", n,
+                        nsamples.load() - n, filename.c_str());
+            }
+#endif
         }
+    };
+#ifdef IDA_PROFILER_ENABLED
+    IDA_profiler::sample *IDA_profiler::samples = NULL;
+    atomic<long> IDA_profiler::nsamples(0);
+    atomic<int> IDA_profiler::context(0);
+    vector<string> IDA_profiler::contexts;
+    bool IDA_profiler::active = false;
+    struct sigaction IDA_profiler::old_action;
+    struct itimerval IDA_profiler::old_timer;
+#endif
 
-        // Print using process_tree() method with print_element() function
-        void print_full_tree(){
-            if (pRootElem) {
-                IDA_xml_utils::process_tree(pRootElem, print_element, "", 0);
+    // Stream buffer of the SQL output file, written with writev(): the bytes written to the
+    // stream are copied to its buffer as usual, but long values can be passed in place with
+    // gather(), without copying them. Pieces of the buffer and gathered spans are kept in an
+    // iovec list, in order, and written when the buffer is full or on flush; so a gathered span
+    // must stay valid until the stream is flushed (e.g. the XML document of a table, whose
+    // texts are gathered, is freed after flushing). Write errors are reported as a failed
+    // stream (overflow or sync fail)
+#ifdef __ivm64__
+    struct iovec { void *iov_base; size_t iov_len; };
+#endif
+    class IDA_sql_sink : public streambuf {
+        static const size_t BUFSIZE = 1 << 16;
+        static const size_t GATHER_MAX = 1 << 20; // Bytes gathered before asking for a flush
+        int fd = -1;
+        vector<char> buf;
+        char *mark;                 // Start of the buffer bytes not yet in the iovec list
+        vector<struct iovec> iov;
+        size_t gathered = 0;
+    public:
+        IDA_sql_sink() : buf(BUFSIZE) { reset(); }
+        ~IDA_sql_sink() { close(); }
+
+        bool open(const string &filename)
+        {
+            fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            return fd >= 0;
+        }
+
+        // Write the pending bytes and close the file; return false on error
+        bool close()
+        {
+            if (fd < 0) return true;
+            bool ok = write_all();
+            ok = (::close(fd) == 0) && ok;
+            fd = -1;
+            return ok;
+        }
+
+        // Append n bytes at p to the output without copying them
+        // Return true if the caller should flush the stream (too many bytes or spans pending)
+        bool gather(const char *p, size_t n)
+        {
+            add_buffer_range();
+            iov.push_back({(void*) p, n});
+            gathered += n;
+            return gathered >= GATHER_MAX || iov.size() >= 1024;
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (!write_all()) return traits_type::eof();
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
             }
+            return traits_type::not_eof(c);
         }
 
-    private:
-        // Get the content of an element, typically a column and append it to string s
+        streamsize xsputn(const char *s, streamsize n) override
+        {
+            if (n > epptr() - pptr()) {
+                if (!write_all()) return 0;
+                // Large strings (e.g. LOB literals) are written in place
+                if (n >= (streamsize) BUFSIZE) {
+                    iov.push_back({(void*) s, (size_t) n});
+                    return write_all() ? n : 0;
+                }
+            }
+            memcpy(pptr(), s, n);
+            pbump(n);
+            return n;
+        }
+
+        int sync() override { return write_all() ? 0 : -1; }
+
+    private:
+        void reset()
+        {
+            setp(buf.data(), buf.data() + buf.size());
+            mark = buf.data();
+            iov.clear();
+            gathered = 0;
+        }
+
+        void add_buffer_range()
+        {
+            if (pptr() > mark) {
+                iov.push_back({(void*) mark, (size_t) (pptr() - mark)});
+                mark = pptr();
+            }
+        }
+
+        // Write the iovec list, resuming after partial writes
+        bool write_all()
+        {
+            add_buffer_range();
+            bool ok = fd >= 0 || iov.empty();
+            for (size_t k = 0; ok && k < iov.size(); ) {
+#ifdef __ivm64__
+                ssize_t w = ::write(fd, iov[k].iov_base, iov[k].iov_len);
+#else
+                ssize_t w = ::writev(fd, &iov[k], (int) std::min(iov.size() - k, (size_t) IOV_MAX));
+#endif
+                if (w < 0) {
+                    ok = (errno == EINTR);
+                    continue;
+                }
+                size_t left = w;
+                while (k < iov.size() && left >= iov[k].iov_len) left -= iov[k++].iov_len;
+                if (left) {
+                    iov[k].iov_base = (char*) iov[k].iov_base + left;
+                    iov[k].iov_len -= left;
+                }
+            }
+            reset();
+            return ok;
+        }
+    };
+
+    // Sequential sweep of the LOB files of a table (option lob_cache_size), for zipped SIARD files:
+    // the LOB files are stored in the zip in an order different from the order of the rows
+    // (record1, record0, record4, ...), so extracting them one by one seeks randomly in the
+    // archive. Instead, when a table starts, the entries under its folder are listed from the
+    // zip index, and they are inflated in archive order into a cache of at most max_bytes;
+    // rows take their LOBs from the cache, which is refilled as they are taken. LOBs not in
+    // the cache (larger than the cache, far from the sweep position or in other folders)
+    // are extracted as usual by the caller
+    class IDA_SIARDlobcache {
+        string zipname;
+        vector<pair<string, long>> entries;   // Entries to sweep (name, size), in archive order
+        size_t next = 0;                      // Next entry to inflate
+        unordered_map<string, pair<char*, long>> cache; // Entries inflated, not taken yet
+        unordered_set<string> taken;          // Entries extracted out of the sweep, to skip them
+        long cached_bytes = 0, max_bytes = 0;
+        size_t prefix_size = 0;               // Length of the table folder
+
+        static void add_entry(const char *name, long size, void *arg)
+        {
+            IDA_SIARDlobcache *c = (IDA_SIARDlobcache*) arg;
+            // Only files in subfolders of the table folder (LOB folders), not the table xml
+            const char *rel = name + c->prefix_size;
+            if (strchr(rel, '/') && rel[strlen(rel) - 1] != '/') {
+                c->entries.push_back(make_pair(string(name), size));
+            }
+        }
+
+        // Inflate entries in archive order while they fit in the cache
+        void fill()
+        {
+            while (next < entries.size()) {
+                const string &name = entries[next].first;
+                long size = entries[next].second;
+                if (taken.count(name) || size > max_bytes) {
+                    next++; // Already extracted, or too large to be cached
+                    continue;
+                }
+                if (cached_bytes + size > max_bytes) break;
+                long n = 0;
+                char *buf;
+                {
+                    IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+                    buf = IDA_unzip_to_buffer(zipname.c_str(), (char*)name.c_str(), &n);
+                }
+                next++;
+                if (buf) {
+                    cache[name] = make_pair(buf, n);
+                    cached_bytes += n;
+                }
+            }
+        }
+
+    public:
+        ~IDA_SIARDlobcache() { clear(); }
+
+        // Start the sweep of the entries whose names start with 'folder' (relative to the zip,
+        // e.g. "content/schema0/table1/") of the zip 'zipname'
+        void start(const string &zipname, const string &folder, long max_bytes)
+        {
+            clear();
+            this->zipname = zipname;
+            this->max_bytes = max_bytes;
+            prefix_size = folder.size();
+            IDA_unzip_list_entries(zipname.c_str(), folder.c_str(), add_entry, this);
+            IDA_log(IDA_LOG_DEBUG, "LOB sweep of '%s': %ld entries", folder.c_str(), (long) entries.size());
+        }
+
+        // Take a LOB file (a path inside the zip being swept) from the cache
+        // Return a buffer allocated with malloc() (to be freed by the caller) and set its size,
+        // or NULL if the file is not in the cache (then it must be extracted by the caller)
+        char *take(const string &lob_file, long &size)
+        {
+            if (entries.empty()) return NULL;
+            string z = IDA_file_utils::get_canonical_file_name(lob_file);
+            if (!IDA_parsing_utils::is_prefix(zipname + "/", z)) return NULL;
+            string name = z.substr(zipname.size() + 1);
+            fill();
+            auto it = cache.find(name);
+            if (it == cache.end()) {
+                taken.insert(name);
+                return NULL;
+            }
+            char *buf = it->second.first;
+            size = it->second.second;
+            cached_bytes -= size;
+            cache.erase(it);
+            taken.insert(name); // In case the same file is referenced again
+            return buf;
+        }
+
+        void clear()
+        {
+            for (auto &e: cache) free(e.second.first);
+            cache.clear();
+            entries.clear();
+            taken.clear();
+            next = 0;
+            cached_bytes = 0;
+        }
+    };
+
+    // Three possibilities: unzip the zip fully, unzipping file by file, or
+    // extracting file by file to memory when the zip itself is held in memory
+    enum unzipmode_e {SIARD_FULL_UNZIP, SIARD_FILE_BY_FILE_UNZIP, SIARD_MEMORY_UNZIP};
+
+    // Main class to process  "content/schema<M>/table<N>/table<N>.xml" archive
+    class IDA_SIARDcontent{
+        XMLDocument doc;
+        XMLElement *pRootElem = NULL;
+
+        string tablename;
+
+        string siardURI;
+        string tmpdir;
+        enum unzipmode_e unzipmode;
+
+        ostream &sqlout = cout;
+        unsigned long ncols = 0;
+        vector<string> siard_colname_v;
+        vector<IDA_SIARD_type_attribute> siard_coltype_v;
+        vector<IDA_SIARDlobfolder> siard_lobfolder_info_v;
+
+        // Physical layout of the table where rows are inserted: its name and the
+        // order of the columns (col_order[k] is the SIARD column stored in position k)
+        string physical_tablename;
+        vector<unsigned long> col_order;
+
+        // Chunked LOB mode: LOB files larger than lob_chunk_size bytes are inserted with
+        // their first chunk, and the rest of the chunks are appended by UPDATE statements
+        // written after the INSERT statement of the row (lob_chunk_size=0 disables it)
+        long lob_chunk_size = 0;
+        struct lob_chunk_pending {
+            string column;  // Name of the column
+            string file;    // LOB file
+            long offset;    // Offset of the first chunk pending to write
+            bool textcast;  // The column has TEXT affinity
+            string data;    // LOB read to memory: the bytes pending to write (file and offset unused)
+            IDA_digest digest; // Digest of the bytes read so far, verified after the last chunk
+        };
+        vector<lob_chunk_pending> pending_lob_chunks;
+
+        // If the output is a IDA_sql_sink, the texts of the long cells that need no escaping
+        // are gathered from the XML document instead of being copied to the INSERT statement;
+        // the sink is flushed before the document is freed
+        IDA_sql_sink *sink = NULL;
+        bool gathered = false;
+
+        // Cells of at least this length are gathered; copying shorter ones is cheaper
+        static const size_t GATHER_MIN_LENGTH = 128;
+
+        void flush_gathered()
+        {
+            if (gathered) {
+                sqlout.rdbuf()->pubsync();
+                gathered = false;
+            }
+        }
+
+        // Return the text of a simple cell that can be written as is (or single-quoted
+        // for TEXT affinity), with its length in n, or NULL if it must be converted
+        static const char *gatherable_text(XMLElement *el, enum IDA_siard_utils::SQLITE_COLTYPES simpletype,
+                                           size_t &n)
+        {
+            const char *t = el ? el->GetText() : NULL;
+            if (!t || el->Attribute("file") || (n = strlen(t)) < GATHER_MIN_LENGTH) return NULL;
+            if (simpletype == IDA_siard_utils::COLTYPE_INTEGER
+                || simpletype == IDA_siard_utils::COLTYPE_REAL
+                || simpletype == IDA_siard_utils::COLTYPE_NUMERIC) return t;
+            return (memchr(t, '\'', n) || strstr(t, "\\u00")) ? NULL : t;
+        }
+
+    public:
+        unsigned long current_col_id = 0;
+        IDA_SIARDcontent(const string& tablename,
+                         const string& siardURI, const string& tmpdir, enum unzipmode_e unzipmode,
+                         ostream &sqlout, unsigned long ncols,
+                         vector<string> siard_colname_v,
+                         vector<IDA_SIARD_type_attribute> siard_coltype_v,
+                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v)
+                         :
+                tablename(tablename), siardURI(siardURI), tmpdir(tmpdir),
+                sqlout(sqlout), ncols(ncols),
+                siard_colname_v(siard_colname_v),
+                siard_coltype_v(siard_coltype_v), siard_lobfolder_info_v(siard_lobfolder_info_v)
+        {
+            this->unzipmode = unzipmode;
+            set_physical_layout(tablename, vector<unsigned long>());
+            clear();
+        }
+
+        // Verify the digest of LOB files (attributes digestType and digest) while reading them
+        bool verify_lob_digests = true;
+
+        // Sequential sweep of the LOB files of this table, if not NULL
+        IDA_SIARDlobcache *lob_cache = NULL;
+
+        // Set the size of the LOB chunks (bytes), or 0 to write LOBs as one only literal
+        // It cannot be less than IDA_LOB_CHUNK_MIN_SIZE
+        void set_lob_chunk_size(long size)
+        {
+            lob_chunk_size = (size > 0) ? std::max(size, (long)IDA_LOB_CHUNK_MIN_SIZE) : 0;
+        }
+
+        void set_verify_lob_digests(bool verify)
+        {
+            verify_lob_digests = verify;
+        }
+
+        void set_lob_cache(IDA_SIARDlobcache *cache)
+        {
+            lob_cache = cache;
+        }
+
+        // If not NULL, the LOB files are not read but only appended to this list, in the
+        // order the rows reference them (see IDA_SIARDmetadata::trace_lobs()), and NULL is written
+        vector<string> *lob_trace = NULL;
+
+        void set_lob_trace(vector<string> *trace)
+        {
+            lob_trace = trace;
+        }
+
+        // Set the table where rows are actually inserted and the order of its columns;
+        // an empty column order means the order of the SIARD columns
+        void set_physical_layout(const string &phys_tablename, const vector<unsigned long> &order)
+        {
+            physical_tablename = phys_tablename;
+            col_order = order;
+            if (col_order.size() != ncols) {
+                col_order.resize(ncols);
+                for (unsigned long k = 0; k < ncols; k++) col_order[k] = k;
+            }
+        }
+
+        ~IDA_SIARDcontent()
+        {
+            flush_gathered();
+        }
+
+        void clear()
+        {
+            flush_gathered();
+            doc.Clear();
+            pRootElem = NULL;
+        }
+
+        // Parse a table xml file
+        // Return 0 if OK, -2 if it is nested deeper than the parser allows, or -1 on other errors
+        int load(const char *xmlfile)
+        {
+            clear();
+            XMLError result = XML_ERROR_FILE_READ_ERROR;
+
+            try {
+                result = doc.LoadFile(xmlfile);
+            } catch (const std::exception &e) {
+                // catch anything thrown within try block that derives from std::exception
+                cerr << "*EXCEPTION loading XML '" << xmlfile << "'" << endl << " what: '" << e.what() << "'" << endl;
+                result = XML_ERROR_FILE_READ_ERROR;
+                //- exit(126);
+            } catch (...){
+                cerr << "*Unknown EXCEPTION loading XML '" << xmlfile << "' result=" << result << "" << endl;
+                result = XML_ERROR_FILE_READ_ERROR;
+                //- exit(127);
+            }
+
+            if (result != XML_SUCCESS){
+                //fprintf(stderr, "Error loading XML file '%s': %d\n", xmlfile, result); // Debug
+                return (result == XML_ELEMENT_DEPTH_EXCEEDED) ? -2 : -1;
+            } else {
+                //fprintf(stderr, "OK loading '%s'\n", xmlfile); // Debug
+                pRootElem = doc.RootElement();
+                // Let us store also the filename
+                // -- xmlfilename = xmlfile;
+                return 0;
+            }
+        }
+
+        int load(string xmlfile)
+        {
+            return load(xmlfile.c_str());
+        }
+
+        // As load(), parsing the XML from a buffer (memory mode)
+        int load_buffer(const char *buf, long size)
+        {
+            clear();
+            XMLError result = doc.Parse(buf, size);
+            if (result != XML_SUCCESS){
+                return (result == XML_ELEMENT_DEPTH_EXCEEDED) ? -2 : -1;
+            }
+            pRootElem = doc.RootElement();
+            return 0;
+        }
+
+        // Method to print one xml element, to be used
+        // in IDA_xml_utils::process_tree
+        static void print_element(XMLElement *pElem, string path, long level, va_list va)
+        {
+            (void) path;
+            (void) va;
+            if (pElem) {
+                const char *elemName = pElem->Name();
+                const char *elemText = pElem->GetText();
+                if (!elemText) elemText = ""; // This element has no string
+                string indent(level, ' '); // Indent with spaces
+                cout << setw(4) << level << "> " << indent << "tagname='" << elemName << "' text='"
+                     << IDA_parsing_utils::trim(elemText) << "'" << " path=" << path << endl;
+            }
+        }
+
+        // Print raw
+        void print_tree(){
+            if (pRootElem) {
+                IDA_xml_utils::print_tree(pRootElem);
+            }
+        }
+
+        // Print using process_tree() method with print_element() function
+        void print_full_tree(){
+            if (pRootElem) {
+                IDA_xml_utils::process_tree(pRootElem, print_element, "", 0);
+            }
+        }
+
+    private:
+        // Get the content of an element, typically a column and append it to string s
         // If textifyblob=true, force sqlite blobs (X'00FF...') to be cast to TEXT; this feature is used when
         // generating json of complex data types
         //
@@ -1868,35 +2833,54 @@ namespace IDA {
                     lob_file = IDA_SIARDlobfolder::combine_lobfolders(lobfolder, el_file);
                 }
 
-                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
+                if (lob_trace) {
+                    lob_trace->push_back(lob_file);
+                    s.append("NULL");
+                    return;
+                }
+
+                bool textcast = (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob);
+                if (textcast) {
                     // If the affinity of this column is TEXT, cast the hex blob
                     // form to text type
                     //-- content = "CAST(";
                     s.append("CAST(");
                 }
 
+                // The digest is computed on the bytes as they are converted to hex
+                IDA_digest digest;
+                if (verify_lob_digests) {
+                    digest = IDA_digest(IDA_xml_utils::get_attribute_value(el, "digestType", ""),
+                                        IDA_xml_utils::get_attribute_value(el, "digest", ""), el_file);
+                }
+
                 // If we assume that the lob_file is not a ".zip"-addressed URI, we can optimize this reading
                 // the file directly, without calling unzipURI(); nevertheless whe are going to be conservative
                 // and not to assume that
+                // LOBs inside complex types (textifyblob) are part of a json expression, so they cannot be chunked
                 static bool optimize_lob_reading = false;
-                if (optimize_lob_reading && SIARD_FULL_UNZIP == unzipmode) {
+                char *lob_buf = NULL;
+                long lob_size = 0;
+                if (lob_cache && (lob_buf = lob_cache->take(lob_file, lob_size))) {
+                    append_lob_buffer_content(s, lob_file, lob_buf, lob_size, textcast, !textifyblob, digest);
+                } else if (optimize_lob_reading && SIARD_FULL_UNZIP == unzipmode) {
                     // The SIARD file has been already unzipped
                     //lob_literal = IDA_siard_utils::file_to_blob_literal_append(lob_file);
-                    IDA_siard_utils::file_to_blob_literal_append(lob_file, s);
-                #ifndef IDA_FULL_UNZIP
-                    IDA_file_utils::delete_temp_file(tmpdir, lob_file);
-                #endif
+                    append_lob_file_content(s, lob_file, textcast, !textifyblob, digest);
+                } else if (SIARD_MEMORY_UNZIP == unzipmode) {
+                    append_lob_memory_content(s, lob_file, textcast, !textifyblob, digest);
                 } else {
-                    string tmp_lob_file = IDA_file_utils::unzipURI(lob_file, tmpdir);
+                    string tmp_lob_file;
+                    {
+                        IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+                        tmp_lob_file = IDA_file_utils::unzipURI(lob_file, tmpdir);
+                    }
                     //lob_literal = IDA_siard_utils::file_to_blob_literal_append(tmp_lob_file);
-                    IDA_siard_utils::file_to_blob_literal_append(tmp_lob_file, s);
-                #ifndef IDA_FULL_UNZIP
-                    IDA_file_utils::delete_temp_file(tmpdir, tmp_lob_file);
-                #endif
+                    append_lob_file_content(s, tmp_lob_file, textcast, !textifyblob, digest);
                 }
 
 
-                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
+                if (textcast) {
                     // If the affinity of this column is TEXT, cast the hex blob
                     // form to text type
                     //-- content.append(" AS TEXT)");
@@ -1905,7 +2889,6 @@ namespace IDA {
             } else {
                 const char *t = el?el->GetText():NULL;
                 string col_text = t?t:"";
-                if (el && el->GetText()) col_text = (string)(el->GetText());
                 if (simpletype == IDA_siard_utils::COLTYPE_INTEGER
                     || simpletype == IDA_siard_utils::COLTYPE_REAL
                     || simpletype == IDA_siard_utils::COLTYPE_NUMERIC) {
@@ -1945,14 +2928,151 @@ namespace IDA {
             return;
         }
 
+        // Append the hex literal of a LOB file to string s, deleting the file if temporary
+        // In chunked LOB mode, if the file is larger than one chunk only its first chunk is appended,
+        // and the rest is queued to be written by write_pending_lob_chunks() after the INSERT
+        // The digest is verified once the whole file is read (after its last chunk in chunked mode)
+        void append_lob_file_content(string &s, const string &lob_file, bool textcast, bool chunkable,
+                                     IDA_digest &digest)
+        {
+            long lob_size = -1;
+            if (lob_chunk_size > 0 && chunkable) {
+                struct stat st;
+                if (!::stat(lob_file.c_str(), &st)) lob_size = st.st_size;
+            }
+            IDA_PROBE2(lob__read__start, tablename.c_str(), lob_file.c_str());
+            if (lob_size > lob_chunk_size) {
+                long n = IDA_siard_utils::file_chunk_to_blob_literal_append(lob_file, s, 0, lob_chunk_size, &digest);
+                IDA_PROBE3(lob__read__end, tablename.c_str(), lob_file.c_str(), n);
+                (void) n; // Only used by the probe
+                pending_lob_chunks.push_back({siard_colname_v[current_col_id], lob_file, lob_chunk_size, textcast,
+                                              "", digest});
+            } else {
+                long n = IDA_siard_utils::file_to_blob_literal_append(lob_file, s, &digest);
+                IDA_PROBE3(lob__read__end, tablename.c_str(), lob_file.c_str(), n);
+                (void) n; // Only used by the probe
+                digest.verify(tablename);
+            #ifndef IDA_FULL_UNZIP
+                IDA_file_utils::delete_temp_file(tmpdir, lob_file);
+            #endif
+            }
+        }
+
+        // As append_lob_file_content(), extracting the LOB from the archive in memory
+        void append_lob_memory_content(string &s, const string &lob_file, bool textcast, bool chunkable,
+                                       IDA_digest &digest)
+        {
+            long lob_size = 0;
+            char *buf;
+            {
+                IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+                buf = IDA_file_utils::unzip_memory_entry(siardURI, lob_file, lob_size);
+            }
+            if (!buf) {
+                cerr << "Error: extracting '" << lob_file << "' (notice: perhaps external file)" << endl;
+            }
+            append_lob_buffer_content(s, lob_file, buf, lob_size, textcast, chunkable, digest);
+        }
+
+        // As append_lob_file_content(), with the LOB already extracted to a buffer (allocated
+        // with malloc(), that is freed here)
+        void append_lob_buffer_content(string &s, const string &lob_file, char *buf, long lob_size,
+                                       bool textcast, bool chunkable, IDA_digest &digest)
+        {
+            IDA_PROBE2(lob__read__start, tablename.c_str(), lob_file.c_str());
+            // The whole LOB is already in memory
+            if (buf) digest.update((uint8_t*)buf, lob_size);
+            digest.verify(tablename);
+            long n = (lob_chunk_size > 0 && chunkable && lob_size > lob_chunk_size) ? lob_chunk_size : lob_size;
+            IDA_siard_utils::char_array_to_blob_literal_append((uint8_t*)buf, n, s);
+            IDA_PROBE3(lob__read__end, tablename.c_str(), lob_file.c_str(), n);
+            if (n < lob_size) {
+                pending_lob_chunks.push_back({siard_colname_v[current_col_id], lob_file, n, textcast,
+                                              string(buf + n, lob_size - n), IDA_digest()});
+            }
+            free(buf);
+        }
+
+        // Write the chunks of LOBs pending after the INSERT of a row, as statements of the form:
+        //   UPDATE t SET c = CAST(c || X'...' AS BLOB) WHERE rowid = last_insert_rowid();
+        //   UPDATE t SET c = c || CAST(X'...' AS TEXT) WHERE rowid = last_insert_rowid();
+        // Each chunk is read from the LOB file and written straight to the output, so that
+        // neither this converter nor sqlite3 need to hold a statement longer than one chunk
+        // (UPDATE does not change last_insert_rowid(); note that WITHOUT ROWID tables are
+        // only used for narrow tables whose values never exceed one chunk)
+        void write_pending_lob_chunks()
+        {
+            for (auto &p: pending_lob_chunks) {
+                string col = IDA_siard_utils::quote_sqlite_identifier(p.column);
+                string stmt_start = "UPDATE '" + physical_tablename + "' SET " + col + " = "
+                                    + (p.textcast ? col + " || CAST(" : "CAST(" + col + " || ");
+                string stmt_end = string(p.textcast ? " AS TEXT)" : " AS BLOB)")
+                                  + " WHERE rowid = last_insert_rowid();\n";
+                string stmt;
+                stmt.reserve(2 * lob_chunk_size + stmt_start.size() + stmt_end.size() + 3);
+                long n, total = 0;
+                IDA_PROBE2(lob__read__start, tablename.c_str(), p.file.c_str());
+                if (!p.data.empty()) {
+                    // The pending bytes are already in memory (memory mode, or LOB from the cache)
+                    for (long off = 0; off < (long)p.data.size(); off += n) {
+                        IDA_cancellation::check();
+                        n = std::min(lob_chunk_size, (long)p.data.size() - off);
+                        stmt = stmt_start;
+                        IDA_siard_utils::char_array_to_blob_literal_append((const uint8_t*)p.data.data() + off, n, stmt);
+                        stmt += stmt_end;
+                        {
+                            IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                            sqlout << stmt;
+                        }
+                        total += n;
+                    }
+                    IDA_PROBE3(lob__read__end, tablename.c_str(), p.file.c_str(), total);
+                    continue;
+                }
+                FILE *f = fopen(p.file.c_str(), "r");
+                if (!f || fseek(f, p.offset, SEEK_SET)) {
+                    cerr << "Error: reading chunks of '" << p.file << "'" << endl;
+                    if (f) fclose(f);
+                    continue;
+                }
+                do {
+                    if (IDA_cancellation::requested()) {
+                        fclose(f);
+                        throw IDA_cancelled();
+                    }
+                    stmt = stmt_start;
+                    n = IDA_siard_utils::stream_to_blob_literal_append(f, stmt, lob_chunk_size, &p.digest);
+                    if (n > 0) {
+                        stmt += stmt_end;
+                        {
+                            IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                            sqlout << stmt;
+                        }
+                        total += n;
+                    }
+                } while (n == lob_chunk_size);
+                IDA_PROBE3(lob__read__end, tablename.c_str(), p.file.c_str(), total);
+                fclose(f);
+                p.digest.verify(tablename);
+            #ifndef IDA_FULL_UNZIP
+                IDA_file_utils::delete_temp_file(tmpdir, p.file);
+            #endif
+            }
+            pending_lob_chunks.clear();
+        }
+
         // Get the content of an element, typically a column, containing a complex data type
         // and append it to string s
+        // The tree path of el is extended in place for the nested elements, and restored
+        // before returning (building a new path per level was quadratic with the depth)
         void append_complex_data_type_content(string &s, XMLElement *el,
                                               const string &siard_typeSchema, const string &siard_typeName,
-                                              long depth= 0, const string &treepath = "")
+                                              long depth, string &treepath)
         {
             //-- string content;
-            string indent = string(1+depth, ' ');
+            // One space per level, up to IDA_JSON_MAX_INDENT levels, so that the output
+            // does not grow with the square of the depth
+            string indent = string(1 + std::min(depth, (long)IDA_JSON_MAX_INDENT), ' ');
             if (0 || el) {
                 // Found the complex data type in the Data Type Table
                 IDA_SIARDtypenode tnode = DataType_Table.get_typenode(siard_typeSchema, siard_typeName);
@@ -1984,9 +3104,14 @@ namespace IDA {
 
                         //-- string json_str="json_array(\n";
                         s.append("json_array(\n");
+                        // Elements <aN> are immediate children of el; they are indexed once, as
+                        // searching the subtree for each one was quadratic (and might find the
+                        // <aN> of a nested array when missing)
+                        unordered_map<string, XMLElement*> children;
+                        IDA_xml_utils::index_children_by_tag(el, children);
                         for (unsigned long i=1; i <= arr_card ; i++){ // Note index starts at 1: <a1></a1>, <a2></a2>...
                             string atag = "a" + to_string(i);
-                            XMLElement *a = IDA_xml_utils::find_element_by_tag(el, atag, IDA_xml_utils::BF);
+                            XMLElement *a = IDA_xml_utils::find_indexed_child_by_tag(children, atag);
                             if (0 || a) {
                                 //-- string cell_content = append_complex_data_type_content(a, arr_schema,
                                 //--                                                     arr_type, depth + 1,
@@ -1995,8 +3120,10 @@ namespace IDA {
                                 //-- if (i < arr_card) json_str.append(",\n");
 
                                 s.append(indent);
-                                append_complex_data_type_content(s, a, arr_schema, arr_type, depth + 1,
-                                                                 treepath + "/" + atag);
+                                size_t len = treepath.size();
+                                treepath.append("/").append(atag);
+                                append_complex_data_type_content(s, a, arr_schema, arr_type, depth + 1, treepath);
+                                treepath.resize(len);
                                 if (i < arr_card) s.append(",\n");
                             } else {
                                 // <aN> tag not found for N: use empty content for this element
@@ -2024,10 +3151,12 @@ namespace IDA {
                         //-- string json_str="json_object(\n";
                         s.append("json_object(\n");
                         // Get recursively the content of each UDT attribute
+                        unordered_map<string, XMLElement*> children;
+                        IDA_xml_utils::index_children_by_tag(el, children);
                         unsigned long att_no = 1;
                         for (const auto& att: tnode.getAttributeList()) {
                             string utag = "u" + to_string(att_no++);
-                            XMLElement *u = IDA_xml_utils::find_element_by_tag(el, utag, IDA_xml_utils::BF);
+                            XMLElement *u = IDA_xml_utils::find_indexed_child_by_tag(children, utag);
                             const string& att_name = att.getName();
                             s.append(indent + "'" + att_name + "', ");
                             if (0 || u) {
@@ -2039,8 +3168,10 @@ namespace IDA {
                                 //--                                                    u_type, depth + 1,
                                 //--                                                    treepath + "/" + att_name);
                                 //-- json_str.append(att_content);
-                                append_complex_data_type_content(s, u, u_schema, u_type, depth + 1,
-                                                                 treepath + "/" + att_name);
+                                size_t len = treepath.size();
+                                treepath.append("/").append(att_name);
+                                append_complex_data_type_content(s, u, u_schema, u_type, depth + 1, treepath);
+                                treepath.resize(len);
                             } else {
                                 // <uN> tag not found for N: use empty content for this element
                                 //json_str.append(indent + "'" + att_name + "', ");
@@ -2089,16 +3220,28 @@ namespace IDA {
                 // Precompute column invariants
                 vector<string> col_cplx_typeSchema(ncols), col_cplx_type(ncols);
                 vector<enum IDA_siard_utils::SQLITE_COLTYPES> col_simple_type(ncols);
+                vector<string> col_treepath0(ncols);
                 for (unsigned long colid = 0; colid < ncols; colid++){
+                    col_treepath0[colid] = "/" + siard_colname_v[colid];
                     col_cplx_typeSchema[colid] = siard_coltype_v[colid].getTypeSchema();
                     col_cplx_type[colid] = siard_coltype_v[colid].getTypeOrTypeName();
                     col_simple_type[colid] = IDA_siard_utils::siard_type_to_sqlite3(col_cplx_type[colid]);
                 }
 
                 //-- string colcontent;
-                string SQL_insert_into_start = "INSERT INTO '" + tablename + "' VALUES (";
+                string SQL_insert_into_start = "INSERT INTO '" + physical_tablename + "' VALUES (";
+
+                // Bytes of INSERT statements written, reported by the rows__progress probe
+                long bytes_written = 0;
+
+                sink = dynamic_cast<IDA_sql_sink*>(sqlout.rdbuf());
+                bool flush_due = false;
+
+                // Columns of the current row, by column id, found in one pass over the row
+                vector<XMLElement*> row_cols(ncols);
 
                 for (unsigned long ir = 0; ir < rows.size(); ir++) {
+                    IDA_cancellation::check();
                     XMLElement *row = rows[ir];
                     if (verbose > 1) {
                         string row_name = "r" + to_string(ir);
@@ -2109,27 +3252,53 @@ namespace IDA {
                     // Traverse columns of the row and write its corresponding INSERT statement
                     string SQL_insert_into = SQL_insert_into_start;
 
-                    // Iterate over the columns of this row
-                    for (unsigned long colid = 0; colid < ncols; colid++){
-                        XMLElement *col;
+                    // Tags of the columns are <c1></c1> <c2></c2>...
+                    // Column number is the integer after the 'c': c1, c2, ...
+                    // Notice the first column is numbered with 1: c1 !!
+                    // Searching each column in the row would be quadratic in wide tables
+                    std::fill(row_cols.begin(), row_cols.end(), (XMLElement*) NULL);
+                    for (XMLElement *pe = row->FirstChildElement(); pe; pe = pe->NextSiblingElement()) {
+                        const char *tag = pe->Name();
+                        if (tag[0] == 'c' && isdigit((unsigned char) tag[1])) {
+                            char *end;
+                            unsigned long c = strtoul(tag + 1, &end, 10);
+                            if (!*end && c >= 1 && c <= ncols && !row_cols[c - 1]) row_cols[c - 1] = pe;
+                        }
+                    }
 
-                        // Tags of the columns are <c1></c1> <c2></c2>...
-                        // Column number is the integer after the 'c': c1, c2, ...
-                        // Notice the first column is numbered with 1: c1 !!
-                        string colname = "c" + to_string(colid + 1);
-                        col = IDA_xml_utils::find_element_by_tag(row, colname);
+                    // Iterate over the columns of this row, in the physical order of the table
+                    for (unsigned long k = 0; k < ncols; k++){
+                        unsigned long colid = col_order[k];
+                        XMLElement *col = row_cols[colid];
 
                         // This is a little dirty trick, using a member for the col id as global
                         current_col_id = colid;
 
-                        (verbose > 2) && sqlout << "--  bogus columnname='" << colname << "'" << endl;
+                        (verbose > 2) && sqlout << "--  bogus columnname='c" << colid + 1 << "'" << endl;
 
                         // Let's generate the column content depending on it is simple or complex data type
                         string &col_siard_typeSchema = col_cplx_typeSchema[colid];
                         // The initial treepath is something like "/columnname"
-                        string treepath0 = "/" + siard_colname_v[colid];
+                        string &treepath0 = col_treepath0[colid]; // Restored after each complex cell
                         // Simple types has no typeSchema, so generate complex content (json) only for complex data types
-                        if (col_siard_typeSchema.empty()) {
+                        size_t span_len;
+                        const char *span = (sink && col_siard_typeSchema.empty())
+                                           ? gatherable_text(col, col_simple_type[colid], span_len) : NULL;
+                        if (span) {
+                            // Write the statement so far, then the text in place
+                            bool quoted = (col_simple_type[colid] != IDA_siard_utils::COLTYPE_INTEGER
+                                           && col_simple_type[colid] != IDA_siard_utils::COLTYPE_REAL
+                                           && col_simple_type[colid] != IDA_siard_utils::COLTYPE_NUMERIC);
+                            if (quoted) SQL_insert_into += '\'';
+                            {
+                                IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                                sqlout << SQL_insert_into;
+                            }
+                            bytes_written += SQL_insert_into.size() + span_len;
+                            flush_due = sink->gather(span, span_len) || flush_due;
+                            gathered = true;
+                            SQL_insert_into.assign(quoted ? "'" : "");
+                        } else if (col_siard_typeSchema.empty()) {
                             // Simple: INTEGER, REAL, NUMERIC, BLOB, TEXT
                             //-- colcontent = append_simple_data_type_content(col, col_simple_type[colid], false, treepath0); // It's fast using sqlite types
                             append_simple_data_type_content(SQL_insert_into, col, col_simple_type[colid], false,
@@ -2144,7 +3313,7 @@ namespace IDA {
 
 
                         //-- SQL_insert_into += colcontent;
-                        if (colid < ncols - 1) SQL_insert_into += ",\n";
+                        if (k < ncols - 1) SQL_insert_into += ",\n";
 
                         #if 0
                         {
@@ -2170,7 +3339,31 @@ namespace IDA {
                     }
 
                     SQL_insert_into += ");\n";
-                    sqlout << SQL_insert_into;
+                    {
+                        IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                        sqlout << SQL_insert_into;
+                    }
+                    bytes_written += SQL_insert_into.size();
+                    if (flush_due) {
+                        IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                        sqlout.flush();
+                        flush_due = false;
+                    }
+                    if (IDA_PROBE_ENABLED(rows__progress) && !((ir + 1) % IDA_PROBE_ROWS_INTERVAL)) {
+                        IDA_PROBE3(rows__progress, tablename.c_str(), (long) (ir + 1), bytes_written);
+                    }
+
+                    // Chunked LOB mode: append the rest of the LOBs of this row
+                    if (!pending_lob_chunks.empty()) {
+                        write_pending_lob_chunks();
+                    }
+                }
+
+                // Write the gathered texts while the document is alive
+                if (gathered) {
+                    IDA_stage_times::scope st(IDA_stage_times::WRITE);
+                    sqlout.flush();
+                    gathered = false;
                 }
             } /* if (pRootElem) */
         }
@@ -2190,6 +3383,15 @@ namespace IDA {
 
         enum unzipmode_e unzipmode = SIARD_FULL_UNZIP;
 
+        // Options tuning the generated SQL (see IDA_siard2sql_opt())
+        IDA_siard2sql_options options = {};
+
+        // LOB files of the table being converted (option lob_cache_size)
+        IDA_SIARDlobcache lob_cache;
+
+        // LOB files referenced by each table file, if tracing them (see trace_lobs())
+        map<string, vector<string>> *lob_trace = NULL;
+
         const string tmpdir_template = "_s2s_tmp";
         const string tmpdir_templateX = tmpdir_template + "XXXXXX";
 
@@ -2219,15 +3421,32 @@ namespace IDA {
 
         IDA_SIARDmetadata(const char *siardURI) : IDA_SIARDmetadata(string(siardURI)) {}
 
+        // The SIARD file is held in memory, in a buffer of 'size' bytes that must remain valid
+        // while this object exists; no temporary directory is used, the files inside the zip
+        // are extracted to memory when needed. A pseudo-path is given to the archive, so that
+        // the paths of the files inside it are built as usual
+        IDA_SIARDmetadata(const void *siardbuf, long size)
+        {
+            clear();
+            char name[64];
+            snprintf(name, sizeof(name), "/siard2sql-memory/%p.siard", siardbuf);
+            siardURI = name;
+            unzipmode = SIARD_MEMORY_UNZIP;
+            IDA_unzip_add_memory_zip(siardURI.c_str(), siardbuf, size);
+        }
+
         ~IDA_SIARDmetadata()
         {
             // Delete recursively the temporary directory on destructing this object
             if (!tmpdir.empty()) {
                 int rmerr = IDA_file_utils::rrm(tmpdir, tmpdir_template);
-                if (!rmerr) cerr << "Temporary directory '" << tmpdir << "' deleted" << endl; // Debug
+                if (!rmerr) IDA_log(IDA_LOG_DEBUG, "Temporary directory '%s' deleted", tmpdir.c_str());
             }
             // Close all zips opened temporarily
             IDA_unzip_close_all();
+            if (SIARD_MEMORY_UNZIP == unzipmode) {
+                IDA_unzip_remove_memory_zip(siardURI.c_str());
+            }
         }
 
         void clear()
@@ -2238,6 +3457,11 @@ namespace IDA {
             tmpdir.clear();
         }
 
+        void set_options(const IDA_siard2sql_options &opts)
+        {
+            options = opts;
+        }
+
         // Parse the metadata.xml file, which must be "header/metadata.xml" relative to siardURI
         int load()
         {
@@ -2247,17 +3471,32 @@ namespace IDA {
             string metadatafile = siardURI + "/header/metadata.xml";
 
             if (SIARD_FILE_BY_FILE_UNZIP == unzipmode) {
+                IDA_stage_times::scope st(IDA_stage_times::INFLATE);
                 metadatafile = IDA_file_utils::unzipURI(metadatafile, tmpdir);
             }
 
             XMLError result = XML_ERROR_FILE_READ_ERROR;
-            result = doc.LoadFile(metadatafile.c_str());
+            char *buf = NULL;
+            long size = 0;
+            if (SIARD_MEMORY_UNZIP == unzipmode) {
+                IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+                buf = IDA_file_utils::unzip_memory_entry(siardURI, metadatafile, size);
+            }
+            {
+                IDA_stage_times::scope st(IDA_stage_times::PARSE);
+                if (SIARD_MEMORY_UNZIP != unzipmode) {
+                    result = doc.LoadFile(metadatafile.c_str());
+                } else if (buf) {
+                    result = doc.Parse(buf, size);
+                }
+                free(buf);
+            }
             if (result == XML_SUCCESS){
-                cerr << "OK loading metadata xml file '" << metadatafile << "'" << endl; // Debug
+                IDA_log(IDA_LOG_DEBUG, "OK loading metadata xml file '%s'", metadatafile.c_str());
                 pRootElem = doc.RootElement();
                 return 0;
             }
-            cerr << "ERROR loading metadata xml file '" << metadatafile << "': " << result << endl; // Debug
+            IDA_log(IDA_LOG_ERROR, "ERROR loading metadata xml file '%s': %d", metadatafile.c_str(), (int)result);
             return -1;
         }
 
@@ -2277,7 +3516,7 @@ namespace IDA {
             }
 
             int ziperr;
-            cerr << "Unzip SIARD file '" << siardURI << "' in folder '" << tmpdir << "'" << endl;
+            IDA_log(IDA_LOG_DEBUG, "Unzip SIARD file '%s' in folder '%s'", siardURI.c_str(), tmpdir.c_str());
 
             if (onlyheader) {
                 ziperr = IDA_unzip_siard_metadata(siardURI.c_str()); // Remember we are using its realpath
@@ -2301,7 +3540,7 @@ namespace IDA {
                     cout << "SIARD version: " << ver << endl;
                     puts("");
                 }
-                cerr << "Done unzipping SIARD file '" << siardURI << "' in folder '" << tmpdir << "'" << endl;
+                IDA_log(IDA_LOG_DEBUG, "Done unzipping SIARD file '%s' in folder '%s'", siardURI.c_str(), tmpdir.c_str());
             }
 
             //  Popd
@@ -2622,8 +3861,6 @@ namespace IDA {
                         (verbose > 1) && sqlout << "--  table='" << table_name << "'"<< endl;
                         (verbose > 1) && sqlout << "--  rows='"  << table_rows << "'"<< endl;
 
-                        SQL_create_table = "CREATE TABLE '" + table_name + "' (\n";
-
                         XMLElement *table_columns;
                         vector<XMLElement*> columns;  // <columns> <column>...</column> ... </columns>
                         table_columns = IDA_xml_utils::find_element_by_tag(tab, "columns");
@@ -2636,6 +3873,26 @@ namespace IDA {
                         vector<IDA_SIARD_type_attribute> siard_coltype_v(columns.size());
                         // This array has the lob folder information for each column
                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v(columns.size());
+                        // This array has the declaration of each column in CREATE TABLE
+                        vector<string> column_decl_v(columns.size());
+                        // This array has the storage class of each column (see siard_type_storage_class())
+                        vector<int> column_class_v(columns.size());
+
+                        XMLElement *table_primarykey;
+                        vector<XMLElement*> primarykey_columns;  // <table> <primaryKey> <name> <column> <column> ...
+                        table_primarykey = IDA_xml_utils::find_element_by_tag(tab, "primaryKey");
+                        IDA_xml_utils::find_elements_by_tag(table_primarykey, "column", primarykey_columns);
+                        vector<string> primarykey_names;
+                        for (auto s: primarykey_columns) {
+                            primarykey_names.push_back(s->GetText());
+                        }
+
+                        // Storage optimization mode: a single-column integer P.K. is declared as
+                        // INTEGER PRIMARY KEY (alias of the rowid), the row width is estimated
+                        // (-1 if unbounded) and it is checked whether all columns conform to STRICT typing
+                        bool pk_rowid_alias = false;
+                        long row_width = 0;
+                        bool strict_conform = true;
 
                         for (unsigned long ic = 0; ic < columns.size(); ic++) {
                             XMLElement *col = columns[ic];
@@ -2672,7 +3929,8 @@ namespace IDA {
                                 complex_type = true;
                             }
                             if (complex_type){
-                                cerr << "Notice: complex type in column '" << column_name << "' of table '" << schema_name << ":" << table_name << "' encoded as json text" << endl;
+                                IDA_log(IDA_LOG_DEBUG, "Notice: complex type in column '%s' of table '%s:%s' encoded as json text",
+                                        column_name.c_str(), schema_name.c_str(), table_name.c_str());
                                 siard_column_type += " [complex type, encoded as json text]";
                             }
 
@@ -2687,9 +3945,28 @@ namespace IDA {
                             string sqlite3_type = IDA_siard_utils::coltype_to_str(sqlite3_coltype);
                             (verbose > 1) && sqlout << "--   column='" << column_name << "' (" << siard_column_type << " -> " << sqlite3_type << ")" << endl;
 
-                            SQL_create_table += "'" + column_name + "' " + sqlite3_type;
-                            if (ic < columns.size()-1 )
-                                SQL_create_table += ",\n";
+                            column_decl_v[ic] = "'" + column_name + "' " + sqlite3_type;
+                            column_class_v[ic] = IDA_siard_utils::siard_type_storage_class(siard_column_type, complex_type);
+                            if (options.optimize_storage) {
+                                if (!complex_type && primarykey_names.size() == 1 && primarykey_names[0] == column_name
+                                    && IDA_siard_utils::is_siard_exact_integer(siard_column_type)) {
+                                    column_decl_v[ic] += " PRIMARY KEY";
+                                    pk_rowid_alias = true;
+                                }
+
+                                long col_width = complex_type ? -1 : IDA_siard_utils::estimate_siard_type_width(siard_column_type);
+                                row_width = (row_width < 0 || col_width < 0) ? -1 : row_width + col_width;
+
+                                // Inline BLOBs are written as quoted text, and missing (NULL) cells as '',
+                                // so only TEXT columns, and INTEGER/REAL columns that cannot be NULL, conform
+                                string nullable = IDA_xml_utils::find_first_child_elementText_by_tag(col, "nullable");
+                                bool col_conform = !complex_type
+                                        && (sqlite3_coltype == IDA_siard_utils::COLTYPE_TEXT
+                                            || ((sqlite3_coltype == IDA_siard_utils::COLTYPE_INTEGER
+                                                 || sqlite3_coltype == IDA_siard_utils::COLTYPE_REAL)
+                                                && nullable == "false"));
+                                strict_conform = strict_conform && col_conform;
+                            }
 
                             // External files (lobFolder information for this column)
                             siard_lobfolder_info_v[ic].init(siardURI, column_name, col, siard_lobfolder);
@@ -2700,30 +3977,83 @@ namespace IDA {
                             #endif
                         }
 
-                        XMLElement *table_primarykey;
-                        vector<XMLElement*> primarykey_columns;  // <table> <primaryKey> <name> <column> <column> ...
-                        table_primarykey = IDA_xml_utils::find_element_by_tag(tab, "primaryKey");
-                        IDA_xml_utils::find_elements_by_tag(table_primarykey, "column", primarykey_columns);
+                        // Physical order of the columns: with option lobs_last the columns are
+                        // stably sorted by storage class, so that small fixed-size values come first
+                        // and LOBs last (sqlite3 stores columns in declaration order, and a LOB
+                        // would push the subsequent columns to overflow pages)
+                        vector<unsigned long> col_order(columns.size());
+                        for (unsigned long ic = 0; ic < columns.size(); ic++) col_order[ic] = ic;
+                        if (options.lobs_last) {
+                            stable_sort(col_order.begin(), col_order.end(),
+                                        [&column_class_v](unsigned long a, unsigned long b) {
+                                            return column_class_v[a] < column_class_v[b];
+                                        });
+                        }
+                        bool reordered = !is_sorted(col_order.begin(), col_order.end());
+
+                        // If reordered, the table is created with another name, and a view
+                        // with the original name and column order is created on it
+                        string physical_table_name = reordered ? table_name + IDA_PHYSICAL_TABLE_SUFFIX : table_name;
+
+                        SQL_create_table = "CREATE TABLE '" + physical_table_name + "' (\n";
+                        for (unsigned long k = 0; k < col_order.size(); k++) {
+                            SQL_create_table += column_decl_v[col_order[k]];
+                            if (k < col_order.size()-1 )
+                                SQL_create_table += ",\n";
+                        }
 
                         // Add primary key when creating the table
                         // CREATE TABLE table_name(c1, c2, ..., PRIMARY KEY (c1, c2))
-                        string SQL_primary_key = ",\n   PRIMARY KEY (";
-                        long cpk = 0;
-                        for (auto s: primarykey_columns) {
-                            string pk_column_name = s->GetText();
-                            SQL_primary_key += "\n   " + pk_column_name + ",";
-                            cpk++;
-                        }
-                        SQL_primary_key[SQL_primary_key.size()-1] = ')'; // Last ',' -> ')'
-                        SQL_primary_key += "\n";
-                        if (cpk++) {
+                        // unless the primary key has become an alias of the rowid
+                        if (!pk_rowid_alias && !primarykey_names.empty()) {
+                            string SQL_primary_key = ",\n   PRIMARY KEY (";
+                            for (auto &pk_column_name: primarykey_names) {
+                                SQL_primary_key += "\n   " + pk_column_name + ",";
+                            }
+                            SQL_primary_key[SQL_primary_key.size()-1] = ')'; // Last ',' -> ')'
+                            SQL_primary_key += "\n";
                             // Add P.K. to the statement to create the table
                             SQL_create_table += SQL_primary_key;
                         }
 
-                        SQL_create_table += ");\n" ;
+                        SQL_create_table += ")";
+
+                        // Table options of the storage optimization mode:
+                        //   - STRICT if all the values generated for the columns conform to their declared type
+                        //   - WITHOUT ROWID if the primary key is composite and rows are narrow, so that
+                        //     lookups by P.K. use one only b-tree
+                        bool without_rowid = options.optimize_storage && primarykey_names.size() > 1
+                                             && row_width >= 0 && row_width <= IDA_NARROW_ROW_SIZE;
+                        bool strict = options.optimize_storage && strict_conform;
+                        if (strict) {
+                            SQL_create_table += " STRICT";
+                        }
+                        if (without_rowid) {
+                            SQL_create_table += (strict ? ", WITHOUT ROWID" : " WITHOUT ROWID");
+                        }
+                        (verbose > 1 && options.optimize_storage) && sqlout << "--  storage="
+                                << (pk_rowid_alias ? "'rowid alias'" : without_rowid ? "'without rowid'" : "'rowid'")
+                                << (strict ? " strict" : "") << endl;
+
+                        SQL_create_table += ";\n" ;
+
+                        if (reordered) {
+                            // CREATE VIEW 'table_name' AS SELECT "c1", "c2", ... FROM 'physical_table_name';
+                            SQL_create_table += "CREATE VIEW '" + table_name + "' AS SELECT\n";
+                            for (unsigned long ic = 0; ic < columns.size(); ic++) {
+                                SQL_create_table += "   " + IDA_siard_utils::quote_sqlite_identifier(siard_colname_v[ic]);
+                                if (ic < columns.size()-1 )
+                                    SQL_create_table += ",\n";
+                            }
+                            SQL_create_table += "\nFROM '" + physical_table_name + "';\n";
+                        }
 
                         // Print SQL "create table ..."
+                        IDA_cancellation::check();
+                        if (IDA_PROBE_ENABLED(table__start)) {
+                            IDA_PROBE3(table__start, schema_name.c_str(), table_name.c_str(), atol(table_rows.c_str()));
+                        }
+                        IDA_profiler::set_context(schema_name, table_name);
                         sqlout << SQL_create_table;
 
                         // Locating path of the file "table<N>.xml" with the content of the table
@@ -2736,10 +4066,19 @@ namespace IDA {
                         (verbose > 2) && sqlout << "--  path='" << table_path << endl;
                         (verbose > 2) && sqlout << "--  table file='" << table_file;
                         if (SIARD_FILE_BY_FILE_UNZIP == unzipmode) {
+                            IDA_stage_times::scope st(IDA_stage_times::INFLATE);
                             table_file = IDA_file_utils::unzipURI(table_file, tmpdir);
                         }
-                        ifstream tf(table_file.c_str());
-                        table_file_ok = tf.good();
+                        // Memory mode: the table file is extracted to a buffer
+                        char *table_buf = NULL;
+                        long table_buf_size = 0;
+                        if (SIARD_MEMORY_UNZIP == unzipmode) {
+                            IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+                            table_buf = IDA_file_utils::unzip_memory_entry(siardURI, table_file, table_buf_size);
+                            table_file_ok = (table_buf != NULL);
+                        } else {
+                            table_file_ok = ifstream(table_file.c_str()).good();
+                        }
                         (verbose > 2) && sqlout << "->" << (table_file_ok?" XML file OK":" XML file not found") << endl;
 
 
@@ -2752,18 +4091,40 @@ namespace IDA {
                                                columns.size(),
                                                siard_colname_v,
                                                siard_coltype_v, siard_lobfolder_info_v);
-                            int errl = C.load(table_file);
+                            C.set_physical_layout(physical_table_name, col_order);
+                            C.set_lob_chunk_size(options.lob_chunk_size);
+                            C.set_verify_lob_digests(options.verify_lob_digests);
+                            if (lob_trace) {
+                                C.set_lob_trace(&(*lob_trace)["content/" + schema_folder + '/' + table_folder + '/' +
+                                                              IDA_file_utils::get_basename(table_folder) + ".xml"]);
+                            } else if (options.lob_cache_size > 0 && SIARD_FULL_UNZIP != unzipmode) {
+                                lob_cache.start(siardURI, "content/" + schema_folder + '/' + table_folder + '/',
+                                                options.lob_cache_size);
+                                C.set_lob_cache(&lob_cache);
+                            }
+                            int errl;
+                            {
+                                IDA_stage_times::scope st(IDA_stage_times::PARSE);
+                                errl = table_buf ? C.load_buffer(table_buf, table_buf_size) : C.load(table_file);
+                                free(table_buf); // Already parsed
+                            }
                             //C.print_tree();              //debug
                             //cerr << ">>>---<<<" << endl; // debug
                             //C.print_full_tree();         // debug
                             //cerr << ">>>---<<<" << endl; // debug
                             if (!errl) {
                                 C.tree_to_sql(std::max(0, verbose - 3));
-                                cerr << "OK converting '" << table_file << "' to sql" << endl; // Debug
+                                IDA_log(IDA_LOG_DEBUG, "OK converting '%s' to sql", table_file.c_str());
+                            } else if (errl == -2) {
+                                // The table cannot be converted, the conversion fails instead of
+                                // leaving the table empty
+                                throw runtime_error("table file '" + table_file + "' is nested deeper than " +
+                                                    to_string(TINYXML2_MAX_ELEMENT_DEPTH) +
+                                                    " levels, the limit of the XML parser");
                             } else {
-                                cerr << "Error loading file '" << table_file << "'" << endl;
+                                IDA_log(IDA_LOG_ERROR, "Error loading file '%s'", table_file.c_str());
                             }
-                            tf.close();
+                            lob_cache.clear(); // LOBs not taken by any row
                         }
 
                     #ifndef IDA_FULL_UNZIP
@@ -2783,7 +4144,7 @@ namespace IDA {
                             IDA_xml_utils::find_elements_by_tag(ck, "column", candidatekey_columns, 2);
                             //CREATE UNIQUE INDEX name_idx ON table (column1, column2);
                             SQL_unique_index += "CREATE UNIQUE INDEX unique_idx" + to_string(iuk) + "_" + candidatekey_name;
-                            SQL_unique_index += " ON " + table_name + " (";
+                            SQL_unique_index += " ON " + physical_table_name + " (";
                             for (auto s: candidatekey_columns) {
                                 string ck_column_name = s->GetText();
                                 SQL_unique_index += "\n  " + ck_column_name + ",";
@@ -2793,6 +4154,10 @@ namespace IDA {
                             iuk++;
                         }
                         sqlout <<  SQL_unique_index;
+                        if (IDA_PROBE_ENABLED(table__end)) {
+                            IDA_PROBE3(table__end, schema_name.c_str(), table_name.c_str(), atol(table_rows.c_str()));
+                        }
+                        IDA_profiler::set_context("", "");
                     }
                 }
 
@@ -2831,68 +4196,94 @@ namespace IDA {
         }
 
         // This version of this method use a filename
-        void tree_to_sql(string outfilename, const char *schema_filter = ".", int verbose= 2)
+        // Return 0 if OK, -1 on error, or IDA_SIARD2SQL_CANCELLED
+        int tree_to_sql(string outfilename, const char *schema_filter = ".", int verbose= 2)
         {
-            ofstream sqloutfile(outfilename);
-            if (!sqloutfile.good()){
+            IDA_sql_sink sink;
+            if (!sink.open(outfilename)){
                 cerr << "Error opening output sqlite file '" << outfilename << "'" << endl;
-                return;
+                return -1;
             }
-            // Raise exception if the file has any bad bit (ofstream::badbit, ofstream::eofbit, ofstream::failbit)
-            sqloutfile.exceptions(~std::ofstream::goodbit);
+            ostream sqloutfile(&sink);
+            // Raise exception if the file has any bad bit (ios::badbit, ios::eofbit, ios::failbit)
+            sqloutfile.exceptions(~std::ios::goodbit);
             try {
                 tree_to_sql(sqloutfile, schema_filter, verbose);
+                if (!sink.close()) throw std::ios_base::failure("error writing '" + outfilename + "'");
+            } catch (const IDA_cancelled &) {
+                return IDA_SIARD2SQL_CANCELLED;
             } catch (const std::exception &e) {
                 // catch anything thrown within try block that derives from std::exception
                 cerr << "*EXCEPTION converting to SQL; " << "  what: '" << e.what() << "'" << endl;
+                return -1;
             } catch (...){
                 cerr << "*Unknown EXCEPTION converting to SQL; " << endl;
+                return -1;
             }
+            return 0;
         }
-    }; /* class IDA_SIARDmetadata */
-} /* namespace IDA */
 
-/* C public API */
+        // List the LOB files referenced by the rows of each table, in row order, without reading
+        // them: the conversion is run discarding the SQL. For each table file, the names inside
+        // the zip of its LOB files are appended to lobs[<table file name inside the zip>]; LOBs
+        // out of the zip (external files) are not listed
+        // Return 0 if OK, -1 on error
+        int trace_lobs(map<string, vector<string>> &lobs)
+        {
+            map<string, vector<string>> trace;
+            ostream nullout(NULL);
+            int rc = 0;
+            lob_trace = &trace;
+            try {
+                tree_to_sql(nullout, "", 0);
+            } catch (const std::exception &e) {
+                cerr << "*EXCEPTION tracing LOB files; " << "  what: '" << e.what() << "'" << endl;
+                rc = -1;
+            } catch (...){
+                cerr << "*Unknown EXCEPTION tracing LOB files; " << endl;
+                rc = -1;
+            }
+            lob_trace = NULL;
+            for (auto &t: trace) {
+                vector<string> &v = lobs[t.first];
+                for (auto &lob_file: t.second) {
+                    string z = IDA_file_utils::get_canonical_file_name(lob_file);
+                    if (IDA_parsing_utils::is_prefix(siardURI + "/", z)) v.push_back(z.substr(siardURI.size() + 1));
+                }
+            }
+            return rc;
+        }
+    }; /* class IDA_SIARDmetadata */
 
-#ifdef __cplusplus
-extern "C" {
+#ifndef __ivm64__
+    // The library keeps global state, so conversions (synchronous or not) run one at a time
+    static mutex IDA_conversion_mutex;
 #endif
-    // See these tutorials and info:
-    // https://shilohjames.wordpress.com/2014/04/27/tinyxml2-tutorial/
-    // https://terminalroot.com/how-to-parser-xml-with-tinyxml2-cpp/
-
-    using namespace IDA;
 
-    __attribute__((constructor)) void IDA_siard2sqlite_initializer_fun()
+    // The conversion of IDA_siard2sql_opt(), cancellable through the flag 'cancel' (if not NULL)
+    // If siardbuf is not NULL, the SIARD file is the buffer of siardsize bytes at siardbuf
+    // and siardfilein is only used in messages
+    static int IDA_siard2sql_run(const char *siardfilein, const void *siardbuf, long siardsize,
+                                 const char *sqlfileout, const char *schema_filter,
+                                 const IDA_siard2sql_options *opts, const atomic<int> *cancel)
     {
-        #ifdef __ivm64__
-        srand(rand() + (unsigned long)__func__);
-        #else
-        srand(rand() + ::time(NULL));
-        #endif
-    }
+#ifndef __ivm64__
+        lock_guard<mutex> lock(IDA_conversion_mutex);
+#endif
+        if (cancel && cancel->load()) {
+            return IDA_SIARD2SQL_CANCELLED; // Cancelled while waiting for another conversion
+        }
 
-    // This is the main C function in charge of converting SIARD to
-    // sqlite3-compliant SQL
-    //
-    // Argument siardfilein can be:
-    //   - A regular SIARD (.zip) file
-    //   - A directory with the unzipped SIARD file (containing
-    //     subdirectories 'header' and 'content')
-    //
-    // Argument sqlfileout can be:
-    //   - A regular file where to write SQL to
-    //   - NULL:   If sqlfileout is NULL, file /header/metadata.xml is only unzipped
-    //             or searched in directory, and a summary of the schemas in metadata
-    //             is printed instead of doing the conversion
-    //
-    // The schema_filter is a regular expression to filter schemas
-    // by name; only those schema names matching it will be converted
-    // Use "" to not filter.
-    //
-    int IDA_siard2sql(const char *siardfilein, const char *sqlfileout, const char *schema_filter)
-    {
-        string realsiard = IDA_file_utils::get_realpath(siardfilein);
+        IDA_siard2sql_options default_opts;
+        if (!opts) {
+            IDA_siard2sql_default_options(&default_opts);
+            opts = &default_opts;
+        }
+        IDA_profiler::session profile(opts->profile_rate,
+                                      opts->profile_file ? opts->profile_file :
+                                      sqlfileout ? string(sqlfileout) + ".folded" : string("siard2sql.folded"));
+
+        string realsiard = siardbuf ? siardfilein : IDA_file_utils::get_realpath(siardfilein);
         if (realsiard.empty()){
             fprintf(stderr, "File/directory '%s' not found\n", siardfilein);
             return -1;
@@ -2908,9 +4299,21 @@ extern "C" {
             schema_filter = "";
         }
 
-        IDA_SIARDmetadata M(siardfilein);
+        unique_ptr<IDA_SIARDmetadata> pM(siardbuf ? new IDA_SIARDmetadata(siardbuf, siardsize)
+                                                  : new IDA_SIARDmetadata(siardfilein));
+        IDA_SIARDmetadata &M = *pM;
+        M.set_options(*opts);
+        IDA_unzip_set_inflate_threads(opts->inflate_threads);
 #ifdef IDA_FULL_UNZIP
-        M.unzip(!sqlfileout);
+        IDA_stage_times::start();
+        IDA_digest::mismatches = 0;
+        if (!siardbuf) {
+            IDA_stage_times::scope st(IDA_stage_times::INFLATE);
+            M.unzip(!sqlfileout);
+        }
+#else
+        IDA_stage_times::start();
+        IDA_digest::mismatches = 0;
 #endif
         int lerr = M.load();
         if (lerr == -1){
@@ -2921,8 +4324,26 @@ extern "C" {
         //  If sqlfileout is not null generate sqlite3 SQL from the siard just parsed
         //  else print only a summary of schemas
         if (sqlfileout) {
-            M.tree_to_sql(sqlfileout, schema_filter);
+            IDA_cancellation::set_flag(cancel);
+            int rc = M.tree_to_sql(sqlfileout, schema_filter);
+            IDA_cancellation::set_flag(NULL);
+            if (rc == IDA_SIARD2SQL_CANCELLED) {
+                // The temporary directory is removed when M is destroyed
+                ::unlink(sqlfileout);
+                IDA_log(IDA_LOG_INFO, "Conversion of '%s' cancelled", siardfilein);
+                IDA_log_flush();
+                return IDA_SIARD2SQL_CANCELLED;
+            }
+            if (rc == -1) {
+                IDA_log_flush();
+                return -1;
+            }
+            IDA_stage_times::report();
+            if (IDA_digest::mismatches > 0) {
+                IDA_log(IDA_LOG_WARNING, "%ld LOB digest mismatches", IDA_digest::mismatches);
+            }
         }
+        IDA_log_flush(); // Pending log messages before the summary
 
         // Printing schemas requires only header/metadata.xml
         puts("");
@@ -2950,6 +4371,331 @@ extern "C" {
         return 0;
     }
 
+    static void IDA_siard_repack_add_entry(const char *name, long /*size*/, void *arg)
+    {
+        ((vector<string>*) arg)->push_back(name);
+    }
+
+    // The rewriting of IDA_siard_repack(): the order of the entries in the new archive is
+    // computed here, and the archive is written by IDA_unzip_repack()
+    static int IDA_siard_repack_run(const char *siardfilein, const char *siardfileout,
+                                    const IDA_siard_repack_options *opts)
+    {
+#ifndef __ivm64__
+        lock_guard<mutex> lock(IDA_conversion_mutex);
+#endif
+        IDA_siard_repack_options default_opts;
+        if (!opts) {
+            IDA_siard_repack_default_options(&default_opts);
+            opts = &default_opts;
+        }
+
+        string realsiard = IDA_file_utils::get_realpath(siardfilein);
+        if (realsiard.empty()){
+            fprintf(stderr, "File '%s' not found\n", siardfilein);
+            return -1;
+        }
+        if (IDA_file_utils::is_directory(realsiard)) {
+            fprintf(stderr, "'%s' is a directory; only zipped SIARD files can be repacked\n", siardfilein);
+            return -1;
+        }
+        if (realsiard == IDA_file_utils::get_realpath(siardfileout)) {
+            fprintf(stderr, "The repacked file cannot be the input file '%s'\n", siardfilein);
+            return -1;
+        }
+
+        // Entries first in the new archive; the rest keep their order
+        vector<string> order;
+        if (opts->lobs_in_row_order) {
+            // The LOB files of each table, in the order its rows reference them
+            map<string, vector<string>> lobs;
+            {
+                IDA_SIARDmetadata M(siardfilein);
+                if (M.load() == -1){
+                    cerr << "Error opening metadata file " << endl;
+                    return -1;
+                }
+                if (M.trace_lobs(lobs) == -1) return -1;
+            }
+            unordered_set<string> traced, placed;
+            for (auto &t: lobs) traced.insert(t.second.begin(), t.second.end());
+
+            // Each table file is followed by its LOB files (placed after the first table that
+            // references them); other entries are kept in their place
+            vector<string> entries;
+            if (IDA_unzip_list_entries(realsiard.c_str(), "", IDA_siard_repack_add_entry, &entries)) {
+                fprintf(stderr, "Error listing the entries of '%s'\n", siardfilein);
+                return -1;
+            }
+            for (const string &e: entries) {
+                if (traced.count(e)) continue;
+                order.push_back(e);
+                auto it = lobs.find(e);
+                if (it == lobs.end()) continue;
+                for (const string &l: it->second) {
+                    if (placed.insert(l).second) order.push_back(l);
+                }
+            }
+            IDA_unzip_close_all();
+            IDA_log(IDA_LOG_DEBUG, "%ld LOB files of %ld tables placed in row order",
+                    (long) placed.size(), (long) lobs.size());
+        }
+
+        vector<const char*> names;
+        names.reserve(order.size());
+        for (const string &e: order) names.push_back(e.c_str());
+        int rc = IDA_unzip_repack(realsiard.c_str(), siardfileout, names.data(), (long) names.size(),
+                                  opts->xml_block_size, opts->store_incompressible);
+        IDA_log_flush();
+        if (rc) {
+            ::unlink(siardfileout);
+            return -1;
+        }
+        return 0;
+    }
+} /* namespace IDA */
+
+/* C public API */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    // See these tutorials and info:
+    // https://shilohjames.wordpress.com/2014/04/27/tinyxml2-tutorial/
+    // https://terminalroot.com/how-to-parser-xml-with-tinyxml2-cpp/
+
+    using namespace IDA;
+
+    __attribute__((constructor)) void IDA_siard2sqlite_initializer_fun()
+    {
+        #ifdef __ivm64__
+        srand(rand() + (unsigned long)__func__);
+        #else
+        srand(rand() + ::time(NULL));
+        #endif
+    }
+
+    // This is the main C function in charge of converting SIARD to
+    // sqlite3-compliant SQL
+    //
+    // Argument siardfilein can be:
+    //   - A regular SIARD (.zip) file
+    //   - A directory with the unzipped SIARD file (containing
+    //     subdirectories 'header' and 'content')
+    //
+    // Argument sqlfileout can be:
+    //   - A regular file where to write SQL to
+    //   - NULL:   If sqlfileout is NULL, file /header/metadata.xml is only unzipped
+    //             or searched in directory, and a summary of the schemas in metadata
+    //             is printed instead of doing the conversion
+    //
+    // The schema_filter is a regular expression to filter schemas
+    // by name; only those schema names matching it will be converted
+    // Use "" to not filter.
+    //
+    int IDA_siard2sql(const char *siardfilein, const char *sqlfileout, const char *schema_filter)
+    {
+        IDA_siard2sql_options opts;
+        IDA_siard2sql_default_options(&opts);
+        return IDA_siard2sql_opt(siardfilein, sqlfileout, schema_filter, &opts);
+    }
+
+    // Set the default conversion options (the same used by IDA_siard2sql())
+    void IDA_siard2sql_default_options(IDA_siard2sql_options *opts)
+    {
+        if (!opts) return;
+        memset(opts, 0, sizeof(IDA_siard2sql_options));
+        opts->optimize_storage = 0;
+        opts->lobs_last = 0;
+        opts->lob_chunk_size = 0;
+        opts->verify_lob_digests = 1;
+        opts->lob_cache_size = 0;
+        opts->inflate_threads = 0;
+        opts->profile_rate = 0;
+        opts->profile_file = NULL;
+    }
+
+    // The same as IDA_siard2sql() but tuning the conversion with some options;
+    // if opts is NULL the default options are used
+    //
+    // Options:
+    //   - optimize_storage: if not zero, single-column integer primary keys are declared
+    //     as INTEGER PRIMARY KEY (an alias of the rowid, so no extra index is created),
+    //     narrow tables with composite primary keys are created WITHOUT ROWID, and
+    //     tables whose values are known to conform to their column types are STRICT
+    //     (the SQL output requires sqlite3 >= 3.37)
+    //   - lobs_last: if not zero, the columns of a table are physically reordered with
+    //     small fixed-size types first and LOBs last, so that columns after a LOB are not
+    //     stored in overflow pages; such a table is named '<table>__physical' and a view
+    //     with the original name and column order is created on it
+    //   - lob_chunk_size: if greater than zero, LOBs larger than this size (bytes, at least
+    //     1024) are inserted with their first chunk, and the rest of chunks are appended with
+    //     UPDATE ... SET c = c || X'...' WHERE rowid = last_insert_rowid() statements, so that
+    //     no SQL statement exceeds sqlite3 limits (SQLITE_MAX_SQL_LENGTH) because of one LOB
+    //   - verify_lob_digests: if not zero (default), the digest of each LOB file (attributes
+    //     digestType/digest: MD5, SHA-1 or SHA-256) is computed while it is converted, and
+    //     mismatches are reported as warnings
+    //   - lob_cache_size: if greater than zero, and the SIARD file is zipped, the LOB files of
+    //     each table are inflated in the order they are stored in the archive (one sequential
+    //     read) into a cache of up to this size (bytes), instead of extracting them one by one
+    //     in the order of the rows; LOBs that do not fit are extracted as usual
+    //   - inflate_threads: if greater than one, zip entries with at least 2 MB of compressed
+    //     data (typically big table files) are inflated with up to this number of threads,
+    //     each one decoding a part of the deflate stream; if the parts cannot be decoded
+    //     separately, the entry is inflated sequentially (the output is the same); entries with
+    //     a seek index (see IDA_siard_repack()) are split at its points, whatever their size
+    //   - profile_rate: if greater than zero, the conversion is profiled sampling the stack this
+    //     many times per second of CPU time (with SIGPROF, so it must not be used by the
+    //     application meanwhile); the folded stacks, rooted at the schema/table converted, are
+    //     written to profile_file (by default the SQL output file name plus '.folded'), to be
+    //     drawn with flamegraph.pl
+    //
+    int IDA_siard2sql_opt(const char *siardfilein, const char *sqlfileout, const char *schema_filter,
+                          const IDA_siard2sql_options *opts)
+    {
+        return IDA_siard2sql_run(siardfilein, NULL, 0, sqlfileout, schema_filter, opts, NULL);
+    }
+
+    // As IDA_siard2sql_opt(), converting a SIARD file held in memory (e.g. received from the
+    // network or mapped from a database blob): 'siardbuf' points to the 'size' bytes of the
+    // zip archive, which must remain valid and unchanged during the conversion. Nothing is
+    // written to the filesystem but the SQL output file: metadata, tables and LOBs are
+    // extracted from the buffer to memory.
+    // Zips nested inside the SIARD archive (e.g. external LOB folders) are not supported.
+    int IDA_siard2sql_buffer(const void *siardbuf, long size, const char *sqlfileout,
+                             const char *schema_filter, const IDA_siard2sql_options *opts)
+    {
+        if (!siardbuf || size <= 0) return -1;
+        return IDA_siard2sql_run("<memory>", siardbuf, size, sqlfileout, schema_filter, opts, NULL);
+    }
+
+    // Asynchronous conversion: a job converts in a thread managed by the library
+    //
+    //   IDA_siard2sql_start(): start converting (same arguments as IDA_siard2sql_opt());
+    //                          return NULL if the job cannot be created
+    //   IDA_siard2sql_poll():  return 1 if the job has finished (so waiting does not block), 0 otherwise
+    //   IDA_siard2sql_cancel(): request the cancellation of the job and return immediately; the
+    //                          conversion stops at the next table, row or LOB chunk, deleting its
+    //                          temporary files and the incomplete SQL output file
+    //   IDA_siard2sql_wait():  wait for the job to finish, release it and return the result of the
+    //                          conversion (as IDA_siard2sql_opt(), or IDA_SIARD2SQL_CANCELLED);
+    //                          every started job must be waited for exactly once
+    //
+    // As the library keeps global state (e.g. the data type table), conversions run one at a
+    // time; jobs started while another conversion is running wait for it to finish.
+    // On ivm64 (no threads), the conversion is done by IDA_siard2sql_start() itself.
+    struct IDA_siard2sql_job {
+        string siardfilein, sqlfileout, schema_filter, profile_file;
+        bool has_sqlfileout, has_schema_filter;
+        IDA_siard2sql_options opts;
+        atomic<int> cancel;
+        atomic<int> done;
+        int result;
+#ifndef __ivm64__
+        thread worker;
+#endif
+    };
+
+    static void IDA_siard2sql_job_run(IDA_siard2sql_job *job)
+    {
+        try {
+            job->result = IDA_siard2sql_run(job->siardfilein.c_str(), NULL, 0,
+                                            job->has_sqlfileout ? job->sqlfileout.c_str() : NULL,
+                                            job->has_schema_filter ? job->schema_filter.c_str() : NULL,
+                                            &job->opts, &job->cancel);
+        } catch (...) {
+            job->result = -1;
+        }
+        job->done.store(1, memory_order_release);
+    }
+
+    IDA_siard2sql_job *IDA_siard2sql_start(const char *siardfilein, const char *sqlfileout,
+                                           const char *schema_filter, const IDA_siard2sql_options *opts)
+    {
+        if (!siardfilein) return NULL;
+        IDA_siard2sql_job *job = new (nothrow) IDA_siard2sql_job;
+        if (!job) return NULL;
+        job->siardfilein = siardfilein;
+        job->has_sqlfileout = (sqlfileout != NULL);
+        if (sqlfileout) job->sqlfileout = sqlfileout;
+        job->has_schema_filter = (schema_filter != NULL);
+        if (schema_filter) job->schema_filter = schema_filter;
+        if (opts) job->opts = *opts;
+        else IDA_siard2sql_default_options(&job->opts);
+        if (job->opts.profile_file) {
+            job->profile_file = job->opts.profile_file;  // The caller's string may not outlive the job
+            job->opts.profile_file = job->profile_file.c_str();
+        }
+        job->cancel.store(0);
+        job->done.store(0);
+        job->result = -1;
+#ifndef __ivm64__
+        try {
+            job->worker = thread(IDA_siard2sql_job_run, job);
+        } catch (const system_error &e) {
+            delete job;
+            return NULL;
+        }
+#else
+        IDA_siard2sql_job_run(job);
+#endif
+        return job;
+    }
+
+    int IDA_siard2sql_poll(IDA_siard2sql_job *job)
+    {
+        return (job && job->done.load(memory_order_acquire)) ? 1 : 0;
+    }
+
+    void IDA_siard2sql_cancel(IDA_siard2sql_job *job)
+    {
+        if (job) job->cancel.store(1);
+    }
+
+    int IDA_siard2sql_wait(IDA_siard2sql_job *job)
+    {
+        if (!job) return -1;
+#ifndef __ivm64__
+        if (job->worker.joinable()) job->worker.join();
+#endif
+        int result = job->result;
+        delete job;
+        return result;
+    }
+
+    // Set the default repacking options (see IDA_siard_repack())
+    void IDA_siard_repack_default_options(IDA_siard_repack_options *opts)
+    {
+        if (!opts) return;
+        memset(opts, 0, sizeof(IDA_siard_repack_options));
+        opts->lobs_in_row_order = 1;
+        opts->xml_block_size = 1 << 20;
+        opts->store_incompressible = 0;
+    }
+
+    // Write a copy of the zipped SIARD file siardfilein to siardfileout, with the same entries
+    // (names, content, dates, attributes) in a layout that converts faster; if opts is NULL the
+    // default options are used
+    //
+    // Options:
+    //   - lobs_in_row_order: if not zero, the LOB files of each table are stored right after the
+    //     table file, in the order its rows reference them, so that the conversion reads them
+    //     sequentially instead of seeking across the archive for each row
+    //   - xml_block_size: if greater than zero, deflated table files larger than two blocks are
+    //     deflated again, fully flushing the stream every block of this size (bytes); the offsets
+    //     of the blocks are written as a seek index in the extra field of the entry, so that the
+    //     conversion with inflate_threads > 1 inflates them in parallel from the block starts
+    //     (other zip tools ignore the index and inflate the entry as usual)
+    //   - store_incompressible: if not zero, deflated entries that deflate does not compress
+    //     (e.g. images, audio, video or zip files) are stored, so they are read with no inflating
+    //
+    // Return 0 if OK, -1 on error (then siardfileout is deleted)
+    int IDA_siard_repack(const char *siardfilein, const char *siardfileout, const IDA_siard_repack_options *opts)
+    {
+        if (!siardfilein || !siardfileout) return -1;
+        return IDA_siard_repack_run(siardfilein, siardfileout, opts);
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,23 +29,86 @@
 
 //------------------------------------------------------------------
 
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] siardfile.siard [sqlitefile.sql [schema filter regex]]\n", prog);
+    fprintf(stderr, "       If SQL output file is omitted, only print schemas found in siard file\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "       -O   optimize storage (rowid alias P.K., WITHOUT ROWID and STRICT tables; sqlite3 >= 3.37)\n");
+    fprintf(stderr, "       -L   reorder table columns physically with LOBs last (a view keeps the original order)\n");
+    fprintf(stderr, "       -C size  split LOBs larger than size bytes in chunks appended by UPDATE statements\n");
+    fprintf(stderr, "       -D   do not verify the digest of LOB files\n");
+    fprintf(stderr, "       -S size  read the LOB files of each table in archive order, caching up to size bytes\n");
+    fprintf(stderr, "       -T n     inflate large zip entries (e.g. big table files) with n threads\n");
+    fprintf(stderr, "       -P rate  profile the conversion sampling rate times per second; folded stacks\n");
+    fprintf(stderr, "                (for flamegraph.pl) are written to sqlitefile.sql.folded\n");
+    fprintf(stderr, "       -M   read the SIARD file into memory and convert it from there (no temporary files)\n");
+    fprintf(stderr, "       -v   verbose, print debug messages about the conversion progress\n");
+}
+
 int main(int argc, char *argv[]) {
     char *siardfile=NULL, *sqlfile=NULL, *schema_filter = "";
+    IDA_siard2sql_options opts;
+    IDA_siard2sql_default_options(&opts);
+    int in_memory = 0;
+    int rc = -1;
+
+    // Options go before the positional arguments
+    int argi = 1;
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1]) {
+        if (!strcmp(argv[argi], "-O")) {
+            opts.optimize_storage = 1;
+        } else if (!strcmp(argv[argi], "-L")) {
+            opts.lobs_last = 1;
+        } else if (!strcmp(argv[argi], "-C") && argi + 1 < argc) {
+            opts.lob_chunk_size = atol(argv[++argi]);
+        } else if (!strcmp(argv[argi], "-D")) {
+            opts.verify_lob_digests = 0;
+        } else if (!strcmp(argv[argi], "-S") && argi + 1 < argc) {
+            opts.lob_cache_size = atol(argv[++argi]);
+        } else if (!strcmp(argv[argi], "-T") && argi + 1 < argc) {
+            opts.inflate_threads = atoi(argv[++argi]);
+        } else if (!strcmp(argv[argi], "-P") && argi + 1 < argc) {
+            opts.profile_rate = atoi(argv[++argi]);
+        } else if (!strcmp(argv[argi], "-M")) {
+            in_memory = 1;
+        } else if (!strcmp(argv[argi], "-v")) {
+            IDA_log_set_level(IDA_LOG_DEBUG);
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", argv[argi]);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        argi++;
+    }
 
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s siardfile.siard [sqlitefile.sql [schema filter regex]]\n", argv[0]);
-        fprintf(stderr, "       If SQL output file is omitted, only print schemas found in siard file\n");
+    if (argc - argi < 1) {
+        usage(argv[0]);
         return EXIT_FAILURE;
     } else {
-        siardfile = argv[1];
-        if (argv[2]){ 
-            sqlfile = argv[2];
-            if (argv[3]) schema_filter = argv[3];
+        siardfile = argv[argi];
+        if (argv[argi+1]){
+            sqlfile = argv[argi+1];
+            if (argv[argi+2]) schema_filter = argv[argi+2];
         }
     }
 
     // SIARD -> SQL
-    IDA_siard2sql(siardfile, sqlfile, schema_filter);
+    if (in_memory) {
+        // Read the whole SIARD file, as if it came from elsewhere
+        char *buf = NULL;
+        long size = 0;
+        FILE *fs = fopen(siardfile, "rb");
+        if (fs && !fseek(fs, 0, SEEK_END) && (size = ftell(fs)) > 0 && !fseek(fs, 0, SEEK_SET)
+            && (buf = malloc(size)) && fread(buf, 1, size, fs) == (size_t)size) {
+            rc = IDA_siard2sql_buffer(buf, size, sqlfile, schema_filter, &opts);
+        } else {
+            fprintf(stderr, "Error reading '%s' into memory\n", siardfile);
+        }
+        if (fs) fclose(fs);
+        free(buf);
+    } else {
+        rc = IDA_siard2sql_opt(siardfile, sqlfile, schema_filter, &opts);
+    }
 
     // Dump full sqlfile (or not)
     const int dump_full_sqlite = 0;
@@ -59,5 +122,5 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    return EXIT_SUCCESS;
+    return (rc < 0) ? EXIT_FAILURE : EXIT_SUCCESS;
 }
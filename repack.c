@@ -0,0 +1,76 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// siard-repack: rewrite a SIARD file in a layout faster to convert (see IDA_siard_repack())
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "siard2sql.h"
+
+//------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] siardfile.siard repacked.siard\n", prog);
+    fprintf(stderr, "       Rewrite a zipped SIARD file, with the same content, so that it converts faster\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "       -R       keep the order of the LOB files (by default, they are stored after their\n");
+    fprintf(stderr, "                table file, in the order of its rows)\n");
+    fprintf(stderr, "       -B size  deflate table files in restartable blocks of size bytes (default 1048576),\n");
+    fprintf(stderr, "                with a seek index to inflate them with several threads (siard2sql -T);\n");
+    fprintf(stderr, "                0 copies them as they are\n");
+    fprintf(stderr, "       -S       store the entries that deflate does not compress (e.g. images, video)\n");
+    fprintf(stderr, "       -v       verbose, print debug messages\n");
+}
+
+int main(int argc, char *argv[]) {
+    IDA_siard_repack_options opts;
+    IDA_siard_repack_default_options(&opts);
+
+    // Options go before the positional arguments
+    int argi = 1;
+    while (argi < argc && argv[argi][0] == '-' && argv[argi][1]) {
+        if (!strcmp(argv[argi], "-R")) {
+            opts.lobs_in_row_order = 0;
+        } else if (!strcmp(argv[argi], "-B") && argi + 1 < argc) {
+            opts.xml_block_size = atol(argv[++argi]);
+        } else if (!strcmp(argv[argi], "-S")) {
+            opts.store_incompressible = 1;
+        } else if (!strcmp(argv[argi], "-v")) {
+            IDA_log_set_level(IDA_LOG_DEBUG);
+        } else {
+            fprintf(stderr, "Unknown option '%s'\n", argv[argi]);
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        argi++;
+    }
+
+    if (argc - argi != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (IDA_siard_repack(argv[argi], argv[argi+1], &opts)) {
+        fprintf(stderr, "Error repacking '%s'\n", argv[argi]);
+        return EXIT_FAILURE;
+    }
+
+    struct stat sin, sout;
+    if (!stat(argv[argi], &sin) && !stat(argv[argi+1], &sout)) {
+        printf("Repacked '%s' (%ld bytes) into '%s' (%ld bytes)\n",
+               argv[argi], (long) sin.st_size, argv[argi+1], (long) sout.st_size);
+    }
+    return EXIT_SUCCESS;
+}
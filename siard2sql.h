@@ -13,6 +13,8 @@
 #ifndef _SIARD2SQL_H_
 #define _SIARD2SQL_H_
 
+#include <stdio.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,10 +27,70 @@ extern "C" {
     int IDA_unzip_siard_full(const char *siardfile);
     int IDA_unzip_siard_metadata(const char* siardfile);
     void IDA_unzip_close_all();
+    char *IDA_unzip_to_buffer(const char* siardfile, char *filename, long *size);
+    void IDA_unzip_add_memory_zip(const char* name, const void *buf, long size);
+    void IDA_unzip_remove_memory_zip(const char* name);
+    typedef void (*IDA_unzip_entry_cb)(const char *name, long size, void *arg);
+    int IDA_unzip_list_entries(const char* siardfile, const char *prefix, IDA_unzip_entry_cb cb, void *arg);
+    void IDA_unzip_set_inflate_threads(int nthreads);
+    int IDA_unzip_repack(const char* siardfile, const char *siardout, const char **order, long norder,
+                         long block_size, int store_incompressible);
+
+    // Options to tune the conversion (see IDA_siard2sql_opt())
+    typedef struct IDA_siard2sql_options {
+        int optimize_storage;   // Use INTEGER PRIMARY KEY, WITHOUT ROWID and STRICT tables when possible
+        int lobs_last;          // Reorder table columns physically, LOBs last, with a view in the original order
+        long lob_chunk_size;    // If > 0, split LOBs in chunks of this size (bytes) appended by UPDATE statements
+        int verify_lob_digests; // Verify the digest (MD5, SHA-1, SHA-256) of LOB files while converting them
+        long lob_cache_size;    // If > 0, read the LOB files of each table from the zip in one sweep, caching this size (bytes)
+        int inflate_threads;    // If > 1, inflate large zip entries (e.g. big table files) with this number of threads
+        int profile_rate;       // If > 0, sample the stack this many times per second (SIGPROF) and write folded stacks
+        const char *profile_file; // Output of the profiler (NULL: the SQL output file name plus ".folded")
+    } IDA_siard2sql_options;
+
+    // Options to rewrite a SIARD file in a layout faster to convert (see IDA_siard_repack())
+    typedef struct IDA_siard_repack_options {
+        int lobs_in_row_order;    // Store the LOB files of each table after the table file, in the order of its rows
+        long xml_block_size;      // If > 0, deflate large table files in restartable blocks of this size, with a seek index
+        int store_incompressible; // Store (not deflate) entries that deflate does not compress, e.g. media files
+    } IDA_siard_repack_options;
+
+    // Logging (see ida_log.h); the library is quiet by default (IDA_LOG_WARNING),
+    // messages about the conversion progress are at level IDA_LOG_DEBUG
+#ifndef IDA_LOG_QUIET
+    #define IDA_LOG_QUIET   0
+    #define IDA_LOG_ERROR   1
+    #define IDA_LOG_WARNING 2
+    #define IDA_LOG_INFO    3
+    #define IDA_LOG_DEBUG   4
+#endif
+    void IDA_log_set_level(int level);
+    int IDA_log_get_level();
+    void IDA_log_set_file(FILE *f);
+    void IDA_log_flush();
 
     // libsiardxml
     char *IDA_get_siard_version_from_dir(const char *path_to_siard, char *buff, long size);
+    void IDA_siard2sql_default_options(IDA_siard2sql_options *opts);
     int IDA_siard2sql(const char *siardfilein, const char* sqlfileout, const char *schema_filter);
+    int IDA_siard2sql_opt(const char *siardfilein, const char* sqlfileout, const char *schema_filter,
+                          const IDA_siard2sql_options *opts);
+    // Convert a SIARD file held in memory (a zip archive of 'size' bytes at 'siardbuf')
+    int IDA_siard2sql_buffer(const void *siardbuf, long size, const char* sqlfileout, const char *schema_filter,
+                             const IDA_siard2sql_options *opts);
+
+    // Rewrite a zipped SIARD file for faster conversions, with the same content
+    void IDA_siard_repack_default_options(IDA_siard_repack_options *opts);
+    int IDA_siard_repack(const char *siardfilein, const char *siardfileout, const IDA_siard_repack_options *opts);
+
+    // Asynchronous conversion (see IDA_siard2sql_start() in libsiardxml.cpp)
+    #define IDA_SIARD2SQL_CANCELLED (-2)
+    typedef struct IDA_siard2sql_job IDA_siard2sql_job;
+    IDA_siard2sql_job *IDA_siard2sql_start(const char *siardfilein, const char* sqlfileout, const char *schema_filter,
+                                           const IDA_siard2sql_options *opts);
+    int IDA_siard2sql_poll(IDA_siard2sql_job *job);
+    void IDA_siard2sql_cancel(IDA_siard2sql_job *job);
+    int IDA_siard2sql_wait(IDA_siard2sql_job *job);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,271 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <strings.h>
+#include <atomic>
+
+#if defined(__ivm64__) && !defined(IDA_LOG_SYNC)
+#define IDA_LOG_SYNC
+#endif
+
+#ifndef IDA_LOG_SYNC
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#endif
+
+#include "ida_log.h"
+
+using namespace std;
+
+namespace IDA {
+
+    #define IDA_LOG_QUEUE_SIZE 1024  // Number of slots of the ring buffer (power of 2)
+    #define IDA_LOG_MSG_SIZE 512     // Longer messages are truncated
+
+    // Bounded multi-producer ring buffer (Vyukov's): a producer claims a position
+    // with a CAS on 'head' and publishes the slot by updating its sequence number;
+    // the only consumer is the writer thread. When the ring is full, producers
+    // yield until the writer frees a slot (messages are never dropped). When the
+    // ring is empty the writer sleeps on a condition variable, and the first producer
+    // that publishes a message after that wakes it up.
+    class IDA_logger {
+        struct slot_t {
+            atomic<size_t> seq;
+            char msg[IDA_LOG_MSG_SIZE];
+        };
+
+        slot_t ring[IDA_LOG_QUEUE_SIZE];
+        atomic<size_t> head;   // Next position to write by producers
+        atomic<size_t> tail;   // Next position to read by the writer
+        atomic<int> level;
+        atomic<FILE*> out;
+#ifndef IDA_LOG_SYNC
+        atomic<bool> stop;
+        atomic<bool> async;
+        atomic<bool> sleeping;  // The writer waits (or is about to wait) on 'wakeup'
+        mutex wakeup_mutex;
+        condition_variable wakeup;
+        once_flag started;
+        thread writer;
+#endif
+
+        static int parse_level(const char *s) {
+            const char *names[] = {"quiet", "error", "warning", "info", "debug"};
+            for (int k = 0; k <= IDA_LOG_DEBUG; k++)
+                if (!strcasecmp(s, names[k])) return k;
+            char *end;
+            long l = strtol(s, &end, 10);
+            return (*s && !*end) ? (int)l : IDA_LOG_WARNING;
+        }
+
+        static void write_msg(FILE *f, const char *msg) {
+            size_t n = strlen(msg);
+            fwrite(msg, 1, n, f);
+            if (n == 0 || msg[n-1] != '\n') fputc('\n', f);
+        }
+
+#ifndef IDA_LOG_SYNC
+        void writer_loop() {
+            int idle = 0;
+            while (true) {
+                size_t pos = tail.load(memory_order_relaxed);
+                slot_t &s = ring[pos & (IDA_LOG_QUEUE_SIZE - 1)];
+                if (s.seq.load(memory_order_acquire) == pos + 1) {
+                    write_msg(out.load(memory_order_relaxed), s.msg);
+                    s.seq.store(pos + IDA_LOG_QUEUE_SIZE, memory_order_release);
+                    tail.store(pos + 1, memory_order_release);
+                    idle = 0;
+                } else if (stop.load(memory_order_acquire) && pos == head.load(memory_order_acquire)) {
+                    break;
+                } else if (idle < 64) {
+                    // Nothing to write: keep latency low for bursts
+                    if (!idle++) fflush(out.load(memory_order_relaxed));
+                    this_thread::yield();
+                } else {
+                    // Sleep until a producer publishes a message; 'sleeping' is set before
+                    // checking the slot again, so that the producer sees it (seq_cst on both sides)
+                    unique_lock<mutex> lock(wakeup_mutex);
+                    sleeping.store(true);
+                    if (s.seq.load() == pos + 1 || stop.load()) {
+                        sleeping.store(false);
+                    } else {
+                        wakeup.wait(lock, [this] { return !sleeping.load() || stop.load(); });
+                    }
+                    idle = 0;
+                }
+            }
+            fflush(out.load(memory_order_relaxed));
+        }
+
+        // Wake the writer up if it sleeps (called after publishing a message)
+        void wake_writer() {
+            if (sleeping.load() && sleeping.exchange(false)) {
+                lock_guard<mutex> lock(wakeup_mutex);
+                wakeup.notify_one();
+            }
+        }
+
+        void start_writer() {
+            try {
+                writer = thread(&IDA_logger::writer_loop, this);
+                async.store(true, memory_order_release);
+                atexit(IDA_log_shutdown);
+            } catch (const system_error &) {
+                // No threads available; keep writing synchronously
+            }
+        }
+
+        static void IDA_log_shutdown();
+#endif
+
+    public:
+        IDA_logger() : head(0), tail(0), level(IDA_LOG_WARNING), out(stderr) {
+            for (size_t k = 0; k < IDA_LOG_QUEUE_SIZE; k++)
+                ring[k].seq.store(k, memory_order_relaxed);
+#ifndef IDA_LOG_SYNC
+            stop.store(false);
+            async.store(false);
+            sleeping.store(false);
+#endif
+            const char *env = getenv("SIARD2SQL_LOG_LEVEL");
+            if (env) level.store(parse_level(env));
+        }
+
+        bool enabled(int l) const {
+            return l > IDA_LOG_QUIET && l <= level.load(memory_order_relaxed);
+        }
+
+        void set_level(int l) { level.store(l); }
+        int get_level() const { return level.load(); }
+        void set_file(FILE *f) { flush(); out.store(f ? f : stderr); }
+
+        void vlog(const char *fmt, va_list ap) {
+#ifndef IDA_LOG_SYNC
+            call_once(started, &IDA_logger::start_writer, this);
+            if (async.load(memory_order_acquire) && !stop.load(memory_order_acquire)) {
+                size_t pos = head.load(memory_order_relaxed);
+                slot_t *s;
+                while (true) {
+                    s = &ring[pos & (IDA_LOG_QUEUE_SIZE - 1)];
+                    size_t seq = s->seq.load(memory_order_acquire);
+                    if (seq == pos) {
+                        if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                            break;
+                    } else if (seq < pos) {
+                        // Ring full
+                        this_thread::yield();
+                        pos = head.load(memory_order_relaxed);
+                    } else {
+                        pos = head.load(memory_order_relaxed);
+                    }
+                }
+                vsnprintf(s->msg, IDA_LOG_MSG_SIZE, fmt, ap);
+                s->seq.store(pos + 1);
+                wake_writer();
+                return;
+            }
+#endif
+            char msg[IDA_LOG_MSG_SIZE];
+            vsnprintf(msg, IDA_LOG_MSG_SIZE, fmt, ap);
+            write_msg(out.load(), msg);
+        }
+
+        // Wait until the writer has emptied the ring
+        void flush() {
+#ifndef IDA_LOG_SYNC
+            if (async.load(memory_order_acquire)) {
+                while (tail.load(memory_order_acquire) != head.load(memory_order_acquire))
+                    this_thread::yield();
+            }
+#endif
+            fflush(out.load());
+        }
+
+#ifndef IDA_LOG_SYNC
+        void shutdown() {
+            if (async.load() && !stop.exchange(true)) {
+                {
+                    lock_guard<mutex> lock(wakeup_mutex);
+                    wakeup.notify_one();
+                }
+                writer.join();
+            }
+        }
+#endif
+    };
+
+    IDA_logger IDA_Log;
+
+#ifndef IDA_LOG_SYNC
+    // Registered with atexit() when the writer starts, so that pending messages are
+    // written and the thread joined before the logger is destroyed
+    void IDA_logger::IDA_log_shutdown() {
+        IDA_Log.shutdown();
+    }
+#endif
+
+} // namespace IDA
+
+
+// C API
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    using namespace IDA;
+
+    void IDA_log(int level, const char *fmt, ...) {
+        if (!IDA_Log.enabled(level)) return;
+        va_list ap;
+        va_start(ap, fmt);
+        IDA_Log.vlog(fmt, ap);
+        va_end(ap);
+    }
+
+    int IDA_log_debug_printf(const char *fmt, ...) {
+        if (!IDA_Log.enabled(IDA_LOG_DEBUG)) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        IDA_Log.vlog(fmt, ap);
+        va_end(ap);
+        return 0;
+    }
+
+    int IDA_log_enabled(int level) {
+        return IDA_Log.enabled(level);
+    }
+
+    void IDA_log_set_level(int level) {
+        IDA_Log.set_level(level);
+    }
+
+    int IDA_log_get_level() {
+        return IDA_Log.get_level();
+    }
+
+    void IDA_log_set_file(FILE *f) {
+        IDA_Log.set_file(f);
+    }
+
+    void IDA_log_flush() {
+        IDA_Log.flush();
+    }
+
+#ifdef __cplusplus
+}
+#endif
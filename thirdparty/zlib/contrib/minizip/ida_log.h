@@ -0,0 +1,63 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// Leveled logging for the library (C and C++ sides)
+//
+// Messages are formatted by the caller into a slot of a lock-free ring buffer
+// and written to the log file (stderr by default) by a background thread, so
+// logging never waits for the terminal while converting. The writer thread is
+// only started by the first message that passes the level filter, hence a
+// quiet library (the default) pays a single comparison per call.
+//
+// The level is IDA_LOG_WARNING by default; it can be changed with
+// IDA_log_set_level() or with the environment variable SIARD2SQL_LOG_LEVEL
+// (a number 0-4 or one of quiet, error, warning, info, debug).
+//
+// On ivm64 (no threads), or if IDA_LOG_SYNC is defined, messages are written
+// synchronously.
+
+#ifndef _IDA_LOG_H_
+#define _IDA_LOG_H_
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef IDA_LOG_QUIET
+#define IDA_LOG_QUIET   0
+#define IDA_LOG_ERROR   1
+#define IDA_LOG_WARNING 2
+#define IDA_LOG_INFO    3
+#define IDA_LOG_DEBUG   4
+#endif
+
+    void IDA_log(int level, const char *fmt, ...)
+#ifdef __GNUC__
+        __attribute__((format(printf, 2, 3)))
+#endif
+        ;
+    int IDA_log_enabled(int level);
+    void IDA_log_set_level(int level);
+    int IDA_log_get_level();
+    void IDA_log_set_file(FILE *f);
+    void IDA_log_flush();
+
+    // printf-like, at debug level (to redirect chatty printf's)
+    int IDA_log_debug_printf(const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
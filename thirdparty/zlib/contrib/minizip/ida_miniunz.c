@@ -13,7 +13,14 @@
 #ifndef main
 #define main _IDA_minunz_main_
 #endif
+// Per-entry extraction messages go to the log (at debug level); ida_log.h
+// is included afterwards, not to include <stdio.h> before miniunz.c does
+int IDA_log_debug_printf(const char *fmt, ...);
+#define MINIUNZ_VERBOSE_PRINTF IDA_log_debug_printf
 #include "miniunz.c"
+#include "ida_probes.h"
+#include "ida_log.h"
+#include "ida_seekindex.h"
 
 #ifndef UNZ_MAXFILENAMEINZIP
 #define UNZ_MAXFILENAMEINZIP (256)
@@ -29,6 +36,14 @@ void IDA_ZIP_add_zip_pending_to_close(unzFile uf);
 unzFile IDA_ZIP_get_zip_pending_to_close();
 long IDA_ZIP_get_zip_number_of_entries(unzFile uf);
 void IDA_ZIP_print_index(unzFile uf);
+int IDA_ZIP_get_memory_zip(const char *zipname, const char **buf, long *size);
+void IDA_ZIP_for_each_entry_by_prefix(unzFile uf, const char *prefix,
+                                      void (*cb)(const char *name, unz_file_pos pos, void *arg), void *arg);
+// From ida_pinflate.cpp
+char *IDA_ZIP_parallel_inflate(const unsigned char *in, long in_size, long out_size, unsigned long crc,
+                               int nthreads);
+char *IDA_ZIP_parallel_inflate_indexed(const unsigned char *in, long in_size, long out_size, unsigned long crc,
+                                       int nthreads, const long *cpos, const long *upos, long npoints);
 
 // Prototypes for this file
 static int IDA_miniunz_create_index(unzFile uf);
@@ -38,9 +53,36 @@ static int IDA_miniunz_do_extract_onefile_indexed(unzFile uf, const char *filena
 static unzFile IDA_miniunz_open(const char *zipfilename);
 static void IDA_miniunz_close_indexed(unzFile uf);
 static int IDA_miniunz_do_extract(unzFile uf, int opt_extract_without_path, int opt_overwrite, const char *password);
+static char* IDA_miniunz_do_extract_onefile_indexed_to_buffer(unzFile uf, const char *filename, int opt_extract_without_path,
+                                           int opt_overwrite, const char *password, long *size_buf);
+static void IDA_fill_memory_filefunc64(zlib_filefunc64_def *pzlib_filefunc_def);
+static char *ida_parallel_inflate_currentfile(unzFile uf, const unz_file_info64 *file_info, long *size_buf);
+static int ida_parallel_extract_currentfile(unzFile uf);
+
+#ifdef IDA_PROBES_ENABLED
+// Semaphores of the probes (see ida_probes.h), in the section where tracers look for them
+#define IDA_PROBE_SEMAPHORE(name) unsigned short siard2sql_##name##_semaphore __attribute__((unused, section(".probes")))
+IDA_PROBE_SEMAPHORE(table__start);
+IDA_PROBE_SEMAPHORE(table__end);
+IDA_PROBE_SEMAPHORE(entry__extract__start);
+IDA_PROBE_SEMAPHORE(entry__extract__end);
+IDA_PROBE_SEMAPHORE(lob__read__start);
+IDA_PROBE_SEMAPHORE(lob__read__end);
+IDA_PROBE_SEMAPHORE(rows__progress);
+#endif
+
+// Threads to inflate large entries (see IDA_miniunz_set_inflate_threads())
+static int ida_inflate_threads = 0;
 
 // Public functions (to be used in libsiardunzip.c)
 
+// Inflate entries whose compressed size is at least 2 MB with up to nthreads threads
+// (see ida_pinflate.cpp); 0 or 1 to inflate every entry sequentially
+void IDA_miniunz_set_inflate_threads(int nthreads)
+{
+    ida_inflate_threads = nthreads;
+}
+
 // Close all pending open zips and remove from the cache
 void IDA_minunz_close_all_open_zip(){
     unzFile uf;
@@ -64,8 +106,16 @@ int IDA_miniunz_do_unzip(const char *zipfilename, char* filename)
 #if 1
         uf = IDA_miniunz_open_indexed(zipfilename);
         if (uf) {
+            IDA_PROBE2(entry__extract__start, zipfilename, filename);
             err = IDA_miniunz_do_extract_onefile_indexed(uf, filename, opt_extract_without_path, opt_overwrite,
                                                          password);
+            if (IDA_PROBE_ENABLED(entry__extract__end)) {
+                unz_file_info64 file_info;
+                long bytes = (!err && unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK) ?
+                                                        (long) file_info.uncompressed_size : 0;
+                IDA_PROBE4(entry__extract__end, zipfilename, filename, bytes, (long) err);
+                (void) bytes; // Only used by the probe
+            }
             IDA_miniunz_close_indexed(uf);
         }
 #else
@@ -83,6 +133,61 @@ int IDA_miniunz_do_unzip(const char *zipfilename, char* filename)
     return err;
 }
 
+// Unzip one file of a zip file into an allocated buffer
+// Return a pointer to the allocated buffer (it needs to be released), and its size in size_buf
+// Return NULL if error
+char* IDA_miniunz_do_unzip_to_buffer(const char *zipfilename, char* filename, long *size_buf)
+{
+    const char *password=NULL;
+    int opt_extract_without_path=0;
+    int opt_overwrite=1;
+    unzFile uf=NULL;
+    char* buff = NULL;
+    if (filename) {
+        uf = IDA_miniunz_open_indexed(zipfilename);
+        if (uf) {
+            IDA_PROBE2(entry__extract__start, zipfilename, filename);
+            buff = IDA_miniunz_do_extract_onefile_indexed_to_buffer(uf, filename, opt_extract_without_path, opt_overwrite,
+                                                         password, size_buf);
+            IDA_PROBE4(entry__extract__end, zipfilename, filename, buff ? *size_buf : 0L, buff ? 0L : 1L);
+            IDA_miniunz_close_indexed(uf);
+        }
+    }
+    return buff;
+}
+
+
+
+// List the entries of a zip file whose names start with prefix, in the order they are
+// stored in the archive, calling cb(name, uncompressed size, arg) for each one
+// (so that extracting them in this order reads the archive sequentially)
+// Return 0 if OK, or an error code otherwise
+typedef struct {
+    unzFile uf;
+    void (*cb)(const char *name, long size, void *arg);
+    void *arg;
+} ida_list_entries_arg;
+
+static void ida_list_entry(const char *name, unz_file_pos pos, void *arg)
+{
+    ida_list_entries_arg *a = (ida_list_entries_arg*) arg;
+    unz_file_info64 file_info;
+    if (unzGoToFilePos(a->uf, &pos) == UNZ_OK
+        && unzGetCurrentFileInfo64(a->uf, &file_info, NULL, 0, NULL, 0, NULL, 0) == UNZ_OK) {
+        a->cb(name, (long) file_info.uncompressed_size, a->arg);
+    }
+}
+
+int IDA_miniunz_list_entries(const char *zipfilename, const char *prefix,
+                             void (*cb)(const char *name, long size, void *arg), void *arg)
+{
+    unzFile uf = IDA_miniunz_open_indexed(zipfilename);
+    if (!uf) return 1;
+    ida_list_entries_arg a = {uf, cb, arg};
+    IDA_ZIP_for_each_entry_by_prefix(uf, prefix, ida_list_entry, &a);
+    IDA_miniunz_close_indexed(uf);
+    return 0;
+}
 
 
 // Static private functions (not to be used outside this file)
@@ -97,7 +202,16 @@ static unzFile IDA_miniunz_open(const char *zipfilename)
         strncpy(filename_try, zipfilename, MAXFILENAME-1);
         /* strncpy doesnt append the trailing NULL, if the string is too long. */
         filename_try[MAXFILENAME] = '\0';
-        uf = unzOpen64(zipfilename);
+        const char *membuf;
+        long memsize;
+        if (IDA_ZIP_get_memory_zip(zipfilename, &membuf, &memsize)) {
+            // A zip in memory: open it through the memory ioapi
+            zlib_filefunc64_def ffunc;
+            IDA_fill_memory_filefunc64(&ffunc);
+            uf = unzOpen2_64(zipfilename, &ffunc);
+        } else {
+            uf = unzOpen64(zipfilename);
+        }
     }
 
     if (uf==NULL) {
@@ -105,7 +219,7 @@ static unzFile IDA_miniunz_open(const char *zipfilename)
         return NULL;
     }
 
-    fprintf(stderr, "%s opened\n",filename_try);
+    IDA_log(IDA_LOG_DEBUG, "%s opened", filename_try);
     return uf;
 }
 
@@ -127,7 +241,7 @@ static unzFile IDA_miniunz_open_indexed(const char *zipfilename){
         IDA_ZIP_add_open_zip(uf, zipfilename); // Add to open zipfile cache
         IDA_miniunz_create_index(uf); // Create its index
 
-        printf("File '%s' open and indexed: found %ld entries\n", zipfilename, IDA_ZIP_get_zip_number_of_entries(uf));
+        IDA_log(IDA_LOG_DEBUG, "File '%s' open and indexed: found %ld entries", zipfilename, IDA_ZIP_get_zip_number_of_entries(uf));
         // Debugging
         //printf("----------------\n");
         //IDA_ZIP_print_index(uf);
@@ -174,6 +288,9 @@ static int IDA_miniunz_do_extract_onefile_indexed(unzFile uf, const char *filena
     if (!err) {
         err = unzGoToFilePos(uf, &pos);
         if (!err) {
+              if (!password && !opt_extract_without_path && ida_parallel_extract_currentfile(uf) == UNZ_OK) {
+                  return UNZ_OK;
+              }
               return do_extract_currentfile(uf,&opt_extract_without_path, &opt_overwrite, password);
         } else {
             printf("Error going to position\n");
@@ -203,7 +320,7 @@ static int IDA_miniunz_create_index(unzFile uf)
             err =  unzGetFilePos(uf, &file_pos);
 
             //fprintf(stdout, "%s \tnof=%ld \tposindir=%ld\n", currentFileName, file_pos.num_of_file, file_pos.pos_in_zip_directory); // Debug
-            if (!(c++%1000)) {printf("."); fflush(stdout);} // Debug
+            if (!(++c % 1000)) IDA_log(IDA_LOG_DEBUG, "  indexing: %ld entries", c);
             IDA_ZIP_add_file_to_index(uf, currentFileName, file_pos);
 
             if (err == UNZ_OK) {
@@ -212,31 +329,9 @@ static int IDA_miniunz_create_index(unzFile uf)
         }
     }
     unzGoToFirstFile(uf); // Let the same position after open
-    fprintf(stdout,"\n"); // Debug
     return err;
 }
 
-
-
-// These functions are not used yet (or any more)
-
-// This implementation run the miniunz program calling the main() function
-// If argument filename is NULL extract the full zip content
-static int IDA_miniunz_do_unzip_main(const char *zipfilename, char* filename)
-{
-    char* argv[16];
-    int argc = 0;
-    argv[argc++] = "miniunz";
-    argv[argc++] = "-x";
-    argv[argc++] = "-o";
-    argv[argc++] = (char*) zipfilename;
-    if (filename) {
-        argv[argc++] = filename;
-    }
-    argv[argc] = 0;
-    return main(argc, argv);
-}
-
 // Extract the current file of a zip into a memory buffer, and return a pointer to this buffer
 // Memory is allocated for this buffer, consequently needs to be deallocated after its use
 //
@@ -245,7 +340,8 @@ static char *ida_do_extract_currentfile_to_buffer(unzFile  uf, const int* popt_e
 {
     char filename_inzip[256];
     int err=UNZ_OK;
-    void* buf;
+    char* buf;
+    long nread = 0;
     *size_buf = 0;
 
     unz_file_info64 file_info;
@@ -256,15 +352,21 @@ static char *ida_do_extract_currentfile_to_buffer(unzFile  uf, const int* popt_e
         return NULL;
     }
 
+    if (!password && (buf = ida_parallel_inflate_currentfile(uf, &file_info, size_buf))) {
+        return buf;
+    }
+
     err = unzOpenCurrentFilePassword(uf,password);
     if (err!=UNZ_OK){
         printf("error %d with zipfile in unzOpenCurrentFilePassword\n",err);
+        return NULL;
     }
 
     *size_buf = file_info.uncompressed_size;
-    buf = (void*)malloc(*size_buf * sizeof(char));
+    buf = (char*)malloc((*size_buf + 1) * sizeof(char)); // +1, for empty files
     if (buf==NULL){
         printf("Error allocating memory\n");
+        unzCloseCurrentFile(uf);
         return NULL;
     }
 
@@ -278,11 +380,19 @@ static char *ida_do_extract_currentfile_to_buffer(unzFile  uf, const int* popt_e
       return <0 with error code if there is an error
         (UNZ_ERRNO for IO error, or zLib error for uncompress error)
     */
-    err = unzReadCurrentFile(uf,buf,*size_buf);
+    // Read in pieces, as the length argument of unzReadCurrentFile() is 32-bit
+    while (nread < *size_buf) {
+        long piece = *size_buf - nread;
+        if (piece > (1L << 30)) piece = 1L << 30;
+        err = unzReadCurrentFile(uf, buf + nread, (unsigned) piece);
+        if (err <= 0) break;
+        nread += err;
+    }
 
-    if (err < *size_buf) {
-        printf("error %d (must be %ld) with zipfile in unzReadCurrentFile\n",err, *size_buf);
-        if (buf) free(buf);
+    // Closing checks the CRC of the file
+    if (nread < *size_buf || unzCloseCurrentFile(uf) != UNZ_OK) {
+        printf("error %d (must be %ld) with zipfile in unzReadCurrentFile\n", err, *size_buf);
+        free(buf);
         return NULL;
     }
 
@@ -309,23 +419,234 @@ static char* IDA_miniunz_do_extract_onefile_indexed_to_buffer(unzFile uf, const
     return NULL;
 }
 
-// Unzip one zip file into an allocated buffer
-// Return a pointer to the allocated buffer (it needs to be release), and its size in size_buf
-// Return NULL if error
-static char* IDA_miniunz_do_unzip_to_buffer(const char *zipfilename, char* filename, long *size_buf)
+// Read the seek index of the current file of a zip (see ida_seekindex.h), if any, into
+// cpos[] and upos[] (with room for IDA_SEEK_INDEX_MAX_POINTS); return the number of points
+static long ida_get_seek_index(unzFile uf, const unz_file_info64 *file_info, long *cpos, long *upos)
 {
-    const char *password=NULL;
-    int opt_extract_without_path=0;
-    int opt_overwrite=1;
-    unzFile uf=NULL;
-    char* buff = NULL;
-    if (filename) {
-        uf = IDA_miniunz_open_indexed(zipfilename);
-        if (uf) {
-            buff = IDA_miniunz_do_extract_onefile_indexed_to_buffer(uf, filename, opt_extract_without_path, opt_overwrite,
-                                                         password, size_buf);
-            IDA_miniunz_close_indexed(uf);
+    unsigned char *extra, *p;
+    long npoints = 0;
+    if (!file_info->size_file_extra || !(extra = (unsigned char*) malloc(file_info->size_file_extra))) return 0;
+    if (unzGetCurrentFileInfo64(uf, NULL, NULL, 0, extra, file_info->size_file_extra, NULL, 0) == UNZ_OK) {
+        for (p = extra; p + 4 <= extra + file_info->size_file_extra; ) {
+            unsigned id = p[0] | (p[1] << 8), size = p[2] | (p[3] << 8);
+            p += 4;
+            if (p + size > extra + file_info->size_file_extra) break;
+            if (id == IDA_SEEK_INDEX_ID) {
+                long k;
+                int j;
+                npoints = size / IDA_SEEK_INDEX_POINT_SIZE;
+                if (npoints > IDA_SEEK_INDEX_MAX_POINTS) npoints = IDA_SEEK_INDEX_MAX_POINTS;
+                for (k = 0; k < npoints; k++) {
+                    unsigned long long c = 0, u = 0;
+                    for (j = 7; j >= 0; j--) {
+                        c = (c << 8) | p[k * IDA_SEEK_INDEX_POINT_SIZE + j];
+                        u = (u << 8) | p[k * IDA_SEEK_INDEX_POINT_SIZE + 8 + j];
+                    }
+                    cpos[k] = (long) c;
+                    upos[k] = (long) u;
+                }
+                break;
+            }
+            p += size;
         }
     }
-    return buff;
+    free(extra);
+    return npoints;
+}
+
+// Inflate the current file of a zip with several threads into an allocated buffer (as
+// ida_do_extract_currentfile_to_buffer()), if it is deflated and large enough, or it has
+// a seek index (written by siard-repack)
+// Return NULL if not possible, then it has to be inflated sequentially
+static char *ida_parallel_inflate_currentfile(unzFile uf, const unz_file_info64 *file_info, long *size_buf)
+{
+    int method, level;
+    long csize = (long) file_info->compressed_size, nread = 0;
+    unsigned char *cbuf;
+    char *buf;
+    long cpos[IDA_SEEK_INDEX_MAX_POINTS], upos[IDA_SEEK_INDEX_MAX_POINTS];
+    long npoints;
+
+    if (ida_inflate_threads < 2 || file_info->compression_method != Z_DEFLATED || (file_info->flag & 1)) {
+        return NULL;
+    }
+    npoints = ida_get_seek_index(uf, file_info, cpos, upos);
+    if (!npoints && csize < (2L << 20)) return NULL;
+    // Read the raw (compressed) data
+    if (unzOpenCurrentFile2(uf, &method, &level, 1) != UNZ_OK) return NULL;
+    cbuf = (unsigned char*) malloc(csize);
+    while (cbuf && nread < csize) {
+        long piece = csize - nread;
+        int n;
+        if (piece > (1L << 30)) piece = 1L << 30;
+        n = unzReadCurrentFile(uf, cbuf + nread, (unsigned) piece);
+        if (n <= 0) break;
+        nread += n;
+    }
+    unzCloseCurrentFile(uf);
+    if (!cbuf || nread < csize) {
+        free(cbuf);
+        return NULL;
+    }
+
+    if (npoints) {
+        buf = IDA_ZIP_parallel_inflate_indexed(cbuf, csize, (long) file_info->uncompressed_size, file_info->crc,
+                                               ida_inflate_threads, cpos, upos, npoints);
+    } else {
+        buf = IDA_ZIP_parallel_inflate(cbuf, csize, (long) file_info->uncompressed_size, file_info->crc,
+                                       ida_inflate_threads);
+    }
+    free(cbuf);
+    if (buf) *size_buf = (long) file_info->uncompressed_size;
+    return buf;
+}
+
+// Extract the current file of a zip to disk (as do_extract_currentfile() with its full path
+// and overwriting) inflating it with several threads, if it is deflated and large enough
+// Return UNZ_OK if extracted, otherwise it has to be extracted sequentially
+static int ida_parallel_extract_currentfile(unzFile uf)
+{
+    char filename_inzip[256];
+    char *buf, *p;
+    long size = 0;
+    FILE *fout;
+    int err = UNZ_OK;
+
+    unz_file_info64 file_info;
+    if (unzGetCurrentFileInfo64(uf,&file_info,filename_inzip,sizeof(filename_inzip),NULL,0,NULL,0) != UNZ_OK) {
+        return UNZ_INTERNALERROR;
+    }
+    if (!(buf = ida_parallel_inflate_currentfile(uf, &file_info, &size))) return UNZ_INTERNALERROR;
+
+    fout = FOPEN_FUNC(filename_inzip,"wb");
+    if (!fout && (p = strrchr(filename_inzip, '/'))) {
+        // Create its directory
+        *p = '\0';
+        makedir(filename_inzip);
+        *p = '/';
+        fout = FOPEN_FUNC(filename_inzip,"wb");
+    }
+    if (!fout || fwrite(buf, 1, size, fout) != (size_t) size) {
+        printf("error in writing extracted file\n");
+        err = UNZ_ERRNO;
+    }
+    if (fout) fclose(fout);
+    free(buf);
+    if (err == UNZ_OK) {
+        MINIUNZ_VERBOSE_PRINTF(" extracting: %s\n",filename_inzip);
+        change_file_date(filename_inzip,file_info.dosDate,file_info.tmu_date);
+    }
+    return err;
+}
+
+// Memory ioapi: zip archives held in a memory buffer (registered with IDA_ZIP_add_memory_zip()),
+// read with no filesystem access at all
+typedef struct {
+    const char *base;
+    ZPOS64_T size;
+    ZPOS64_T pos;
+} IDA_mem_stream;
+
+static voidpf ZCALLBACK IDA_mem_open64(voidpf opaque, const void* filename, int mode)
+{
+    const char *base;
+    long size;
+    IDA_mem_stream *m;
+    (void) opaque;
+    if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ)
+        return NULL; // Read only
+    if (!IDA_ZIP_get_memory_zip((const char*) filename, &base, &size))
+        return NULL;
+    m = (IDA_mem_stream*) malloc(sizeof(IDA_mem_stream));
+    if (m) {
+        m->base = base;
+        m->size = (ZPOS64_T) size;
+        m->pos = 0;
+    }
+    return m;
+}
+
+static uLong ZCALLBACK IDA_mem_read(voidpf opaque, voidpf stream, void* buf, uLong size)
+{
+    IDA_mem_stream *m = (IDA_mem_stream*) stream;
+    (void) opaque;
+    if (m->pos >= m->size) return 0;
+    if (size > m->size - m->pos) size = (uLong) (m->size - m->pos);
+    memcpy(buf, m->base + m->pos, size);
+    m->pos += size;
+    return size;
+}
+
+static uLong ZCALLBACK IDA_mem_write(voidpf opaque, voidpf stream, const void* buf, uLong size)
+{
+    (void) opaque; (void) stream; (void) buf; (void) size;
+    return 0;
+}
+
+static ZPOS64_T ZCALLBACK IDA_mem_tell64(voidpf opaque, voidpf stream)
+{
+    (void) opaque;
+    return ((IDA_mem_stream*) stream)->pos;
+}
+
+static long ZCALLBACK IDA_mem_seek64(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin)
+{
+    IDA_mem_stream *m = (IDA_mem_stream*) stream;
+    ZPOS64_T newpos;
+    (void) opaque;
+    switch (origin) {
+        case ZLIB_FILEFUNC_SEEK_SET: newpos = offset; break;
+        case ZLIB_FILEFUNC_SEEK_CUR: newpos = m->pos + offset; break;
+        case ZLIB_FILEFUNC_SEEK_END: newpos = m->size + offset; break;
+        default: return -1;
+    }
+    if (newpos > m->size) return -1;
+    m->pos = newpos;
+    return 0;
+}
+
+static int ZCALLBACK IDA_mem_close(voidpf opaque, voidpf stream)
+{
+    (void) opaque;
+    free(stream);
+    return 0;
+}
+
+static int ZCALLBACK IDA_mem_error(voidpf opaque, voidpf stream)
+{
+    (void) opaque; (void) stream;
+    return 0;
+}
+
+static void IDA_fill_memory_filefunc64(zlib_filefunc64_def *pzlib_filefunc_def)
+{
+    pzlib_filefunc_def->zopen64_file = IDA_mem_open64;
+    pzlib_filefunc_def->zread_file = IDA_mem_read;
+    pzlib_filefunc_def->zwrite_file = IDA_mem_write;
+    pzlib_filefunc_def->ztell64_file = IDA_mem_tell64;
+    pzlib_filefunc_def->zseek64_file = IDA_mem_seek64;
+    pzlib_filefunc_def->zclose_file = IDA_mem_close;
+    pzlib_filefunc_def->zerror_file = IDA_mem_error;
+    pzlib_filefunc_def->opaque = NULL;
+}
+
+
+
+// These functions are not used yet (or any more)
+
+// This implementation run the miniunz program calling the main() function
+// If argument filename is NULL extract the full zip content
+static int IDA_miniunz_do_unzip_main(const char *zipfilename, char* filename)
+{
+    char* argv[16];
+    int argc = 0;
+    argv[argc++] = "miniunz";
+    argv[argc++] = "-x";
+    argv[argc++] = "-o";
+    argv[argc++] = (char*) zipfilename;
+    if (filename) {
+        argv[argc++] = filename;
+    }
+    argv[argc] = 0;
+    return main(argc, argv);
 }
@@ -15,6 +15,12 @@
 #include <queue>
 #include <set>
 #include <regex>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <cctype>
 
 #include "unzip.h"
 
@@ -22,11 +28,241 @@ using namespace std;
 
 namespace IDA {
 
+    // Set of interned strings, stored one after another in an arena; each string
+    // gets an id (0, 1, ...) in the order it is added
+    class IDA_ZIP_strings {
+        string arena;
+        vector<size_t> offsets {0};  // String k is arena[offsets[k], offsets[k+1])
+        vector<uint32_t> slots;      // Open addressing hash table of ids+1 (0 = empty)
+
+        static size_t hash(const char *p, size_t n) {
+            size_t h = 14695981039346656037ULL;  // FNV-1a
+            for (size_t k = 0; k < n; k++) h = (h ^ (unsigned char) p[k]) * 1099511628211ULL;
+            return h;
+        }
+
+        bool equal(uint32_t id, const char *p, size_t n) const {
+            return offsets[id + 1] - offsets[id] == n && !memcmp(arena.data() + offsets[id], p, n);
+        }
+
+        void rehash(size_t nslots) {
+            slots.assign(nslots, 0);
+            for (uint32_t id = 0; id + 1 < offsets.size(); id++) {
+                size_t s = hash(arena.data() + offsets[id], offsets[id + 1] - offsets[id]) & (nslots - 1);
+                while (slots[s]) s = (s + 1) & (nslots - 1);
+                slots[s] = id + 1;
+            }
+        }
+
+    public:
+        size_t size() const { return offsets.size() - 1; }
+
+        string get(uint32_t id) const { return arena.substr(offsets[id], offsets[id + 1] - offsets[id]); }
+
+        // The characters of a string (not null-terminated) and its length
+        const char *data(uint32_t id) const { return arena.data() + offsets[id]; }
+        size_t length(uint32_t id) const { return offsets[id + 1] - offsets[id]; }
+
+        // Compare string id with p[0..n) (as strcmp())
+        int compare(uint32_t id, const char *p, size_t n) const {
+            int c = memcmp(data(id), p, std::min(length(id), n));
+            return c ? c : (length(id) < n ? -1 : length(id) > n ? 1 : 0);
+        }
+
+        // Return the id of a string, or -1 if not present
+        long find(const char *p, size_t n) const {
+            if (slots.empty()) return -1;
+            for (size_t s = hash(p, n) & (slots.size() - 1); slots[s]; s = (s + 1) & (slots.size() - 1)) {
+                if (equal(slots[s] - 1, p, n)) return slots[s] - 1;
+            }
+            return -1;
+        }
+
+        // Return the id of a string, adding it if not present
+        uint32_t add(const char *p, size_t n) {
+            long id = find(p, n);
+            if (id >= 0) return id;
+            if (2 * (size() + 1) > slots.size()) rehash(std::max((size_t) 64, 2 * slots.size()));
+            arena.append(p, n);
+            offsets.push_back(arena.size());
+            size_t s = hash(p, n) & (slots.size() - 1);
+            while (slots[s]) s = (s + 1) & (slots.size() - 1);
+            slots[s] = size();
+            return size() - 1;
+        }
+    };
+
     // This index is a dictionary with pairs (filename, position)
     // There must be an index for each open zip
+    //
+    // SIARD archives may have millions of entries with regular names, such as
+    // content/schema0/table3/lob5/record1234.bin, so names are not stored as such:
+    // each one is split into its directory, a name template (the file name without its
+    // last run of digits, "record.bin") and the number of that run (1234). Directories
+    // and templates are interned, so an entry is a key of three integers plus its position,
+    // kept in a vector in archive order and found through an open addressing hash table:
+    // neither the memory of the index nor the lookups depend on the length of the names
     class IDA_ZIP_index {
-        map<string, unz_file_pos> zipindex;
-        friend class IDA_ZIP_opentable;
+        // Name templates: file name prefix, '\0', width of the number, file name suffix.
+        // The width is the number of digits if they have leading zeros, 0 if they have not
+        // (the number is printed as is) or NO_NUMBER if the name has no digits
+        static const char NO_NUMBER = (char) 0xff;
+
+        struct entry {
+            uint32_t dir;
+            uint32_t tmpl;
+            uint64_t number;
+            unz_file_pos pos;
+        };
+
+        IDA_ZIP_strings dirs;
+        IDA_ZIP_strings templates;
+        vector<entry> entries;              // In the order they are added (archive order)
+        vector<vector<uint32_t>> dir_entries; // Entries of each directory
+        vector<uint32_t> sorted_dirs;       // Directory ids sorted by name (built by the first prefix query)
+        vector<uint32_t> slots;             // Open addressing hash table of entry indexes+1
+        string tmpl_buf;                    // Scratch template, to avoid allocations
+
+        static size_t hash(uint32_t dir, uint32_t tmpl, uint64_t number) {
+            uint64_t h = (((uint64_t) dir << 32) | tmpl) * 0x9e3779b97f4a7c15ULL;
+            h ^= number + 0x632be59bd9b4e019ULL + (h << 6) + (h >> 2);
+            return h ^ (h >> 29);
+        }
+
+        // Split a file name (without directory) into template (in tmpl_buf) and number
+        void split_name(const char *name, size_t n, uint64_t &number) {
+            size_t end = n;
+            while (end > 0 && !isdigit((unsigned char) name[end - 1])) end--;
+            size_t start = end;
+            while (start > 0 && isdigit((unsigned char) name[start - 1])) start--;
+            char width = NO_NUMBER;
+            number = 0;
+            // At most 18 digits, so that it fits in the number
+            if (end > start && end - start <= 18) {
+                for (size_t k = start; k < end; k++) number = 10 * number + (name[k] - '0');
+                width = (name[start] == '0' && end - start > 1) ? (char) (end - start) : 0;
+            } else {
+                start = end = n;
+            }
+            tmpl_buf.assign(name, start);
+            tmpl_buf.push_back('\0');
+            tmpl_buf.push_back(width);
+            tmpl_buf.append(name + end, n - end);
+        }
+
+        // Return the index of the entry with a name, or -1 if not present
+        long find(const char *filename) {
+            if (slots.empty()) return -1;
+            const char *slash = strrchr(filename, '/');
+            size_t dirlen = slash ? slash - filename + 1 : 0;
+            long dir = dirs.find(filename, dirlen);
+            if (dir < 0) return -1;
+            uint64_t number;
+            split_name(filename + dirlen, strlen(filename + dirlen), number);
+            long tmpl = templates.find(tmpl_buf.data(), tmpl_buf.size());
+            if (tmpl < 0) return -1;
+            for (size_t s = hash(dir, tmpl, number) & (slots.size() - 1); slots[s]; s = (s + 1) & (slots.size() - 1)) {
+                const entry &e = entries[slots[s] - 1];
+                if (e.dir == dir && e.tmpl == tmpl && e.number == number) return slots[s] - 1;
+            }
+            return -1;
+        }
+
+        void rehash(size_t nslots) {
+            slots.assign(nslots, 0);
+            for (uint32_t k = 0; k < entries.size(); k++) {
+                const entry &e = entries[k];
+                size_t s = hash(e.dir, e.tmpl, e.number) & (nslots - 1);
+                while (slots[s]) s = (s + 1) & (nslots - 1);
+                slots[s] = k + 1;
+            }
+        }
+
+    public:
+        size_t size() const { return entries.size(); }
+
+        // Add an entry, or update its position if already present
+        void add(const char *filename, unz_file_pos pos) {
+            long k = find(filename);
+            if (k >= 0) {
+                entries[k].pos = pos;
+                return;
+            }
+            const char *slash = strrchr(filename, '/');
+            size_t dirlen = slash ? slash - filename + 1 : 0;
+            entry e;
+            e.dir = dirs.add(filename, dirlen);
+            split_name(filename + dirlen, strlen(filename + dirlen), e.number);
+            e.tmpl = templates.add(tmpl_buf.data(), tmpl_buf.size());
+            e.pos = pos;
+            if (2 * (entries.size() + 1) > slots.size()) rehash(std::max((size_t) 1024, 2 * slots.size()));
+            entries.push_back(e);
+            size_t s = hash(e.dir, e.tmpl, e.number) & (slots.size() - 1);
+            while (slots[s]) s = (s + 1) & (slots.size() - 1);
+            slots[s] = entries.size();
+            if (dir_entries.size() <= e.dir) dir_entries.resize(e.dir + 1);
+            dir_entries[e.dir].push_back(entries.size() - 1);
+        }
+
+        // Get the position of an entry; return false if not present
+        bool get(const char *filename, unz_file_pos *pos) {
+            long k = find(filename);
+            if (k < 0) return false;
+            *pos = entries[k].pos;
+            return true;
+        }
+
+        // Rebuild the name of the k-th entry
+        string name(size_t k) const {
+            const entry &e = entries[k];
+            string t = templates.get(e.tmpl);
+            size_t z = t.find('\0');
+            string s = dirs.get(e.dir) + t.substr(0, z);
+            char width = t[z + 1];
+            if (width != NO_NUMBER) {
+                string num = to_string(e.number);
+                if (num.size() < (size_t) width) s.append(width - num.size(), '0');
+                s += num;
+            }
+            return s + t.substr(z + 2);
+        }
+
+        unz_file_pos get_pos(size_t k) const { return entries[k].pos; }
+
+        // Get the entries whose names start with a prefix, in archive order
+        // Only the directories starting with the prefix are visited (a range of the directories
+        // sorted by name), plus the directory of the prefix if it ends inside the file names
+        void get_entries_by_prefix(const string &prefix, vector<pair<string, unz_file_pos>> &result) {
+            size_t first = result.size();
+            if (sorted_dirs.size() != dirs.size()) {
+                sorted_dirs.resize(dirs.size());
+                for (uint32_t d = 0; d < dirs.size(); d++) sorted_dirs[d] = d;
+                sort(sorted_dirs.begin(), sorted_dirs.end(), [this](uint32_t a, uint32_t b) {
+                    return dirs.compare(a, dirs.data(b), dirs.length(b)) < 0;
+                });
+            }
+            auto it = lower_bound(sorted_dirs.begin(), sorted_dirs.end(), prefix, [this](uint32_t d, const string &p) {
+                return dirs.compare(d, p.data(), p.size()) < 0;
+            });
+            for (; it != sorted_dirs.end(); ++it) {
+                uint32_t d = *it;
+                if (dirs.length(d) < prefix.size() || memcmp(dirs.data(d), prefix.data(), prefix.size())) break;
+                if (d >= dir_entries.size()) continue;
+                for (uint32_t k: dir_entries[d]) result.push_back(make_pair(name(k), entries[k].pos));
+            }
+            size_t dirlen = prefix.rfind('/') + 1; // 0 if no '/'
+            long d = (dirlen < prefix.size()) ? dirs.find(prefix.data(), dirlen) : -1;
+            if (d >= 0 && (size_t) d < dir_entries.size()) {
+                for (uint32_t k: dir_entries[d]) {
+                    string s = name(k);
+                    if (!s.compare(0, prefix.size(), prefix)) result.push_back(make_pair(s, entries[k].pos));
+                }
+            }
+            sort(result.begin() + first, result.end(),
+                 [](const pair<string, unz_file_pos> &a, const pair<string, unz_file_pos> &b) {
+                     return a.second.pos_in_zip_directory < b.second.pos_in_zip_directory;
+                 });
+        }
     };
 
     // Zip Table, a table for open zips, each one with its index
@@ -65,7 +301,7 @@ namespace IDA {
         // This index is a dictionary with pairs (filename, position)
         void add_file_pos(unzFile uf, const string &filename, unz_file_pos pos) {
             try {
-                ZT.at(uf).zipindex[filename] = pos;
+                ZT.at(uf).add(filename.c_str(), pos);
             } catch (...) {
                 // TODO: show error message or something
             }
@@ -75,8 +311,7 @@ namespace IDA {
         // Return 0 if OK, or an error code otherwise
         int get_file_pos(unzFile uf, const string &filename, unz_file_pos *pos) {
             try {
-                *pos = ZT.at(uf).zipindex[filename];
-                return 0;
+                if (ZT.at(uf).get(filename.c_str(), pos)) return 0;
             } catch (...) {
                 // TODO: show error message or something
             }
@@ -111,10 +346,19 @@ namespace IDA {
             else return *(CZ.begin());
         }
 
+        // Get the entries of an open zip whose names start with a prefix, in the order
+        // they are stored in the archive (the order of the central directory)
+        void get_entries_by_prefix(unzFile uf, const string &prefix, vector<pair<string, unz_file_pos>> &entries) {
+            try {
+                ZT.at(uf).get_entries_by_prefix(prefix, entries);
+            } catch (...) {
+            }
+        }
+
         // Return the number of files in the ZIP index, for an open zip file
         long get_zip_number_of_entries(unzFile uf) {
             try {
-                return  ZT.at(uf).zipindex.size();
+                return  ZT.at(uf).size();
             } catch (...) {
             }
             return 0;
@@ -122,13 +366,14 @@ namespace IDA {
 
         // Debugging function, print the ZIP index for an open zip file
         void print_zip_index(unzFile uf, long limit=0) {
-            cout << "Index has " << ZT.at(uf).zipindex.size() << " entries" << endl;
+            IDA_ZIP_index &index = ZT.at(uf);
+            cout << "Index has " << index.size() << " entries" << endl;
             if (limit > 0){
                 cout << "Showing the first " << limit << " ones:" << endl;
             }
             long c = 0;
-            for (auto i = ZT.at(uf).zipindex.begin(); i != ZT.at(uf).zipindex.end(); i++) {
-                cout << i->first << " \t\t\t" << i->second.num_of_file << endl;
+            for (size_t k = 0; k < index.size(); k++) {
+                cout << index.name(k) << " \t\t\t" << index.get_pos(k).num_of_file << endl;
                 if (limit > 0)
                     if (c++ > limit)
                         break;
@@ -188,6 +433,15 @@ extern "C" {
         return Z.get_zip_pending_to_close();
     }
 
+    // Call cb(name, pos, arg) for the entries of an open zip whose names start with
+    // prefix, in archive order
+    void IDA_ZIP_for_each_entry_by_prefix(unzFile uf, const char *prefix,
+                                          void (*cb)(const char *name, unz_file_pos pos, void *arg), void *arg) {
+        vector<pair<string, unz_file_pos>> entries;
+        Z.get_entries_by_prefix(uf, prefix, entries);
+        for (auto &e: entries) cb(e.first.c_str(), e.second, arg);
+    }
+
     // Print the index of an open zip (for debugging)
     long IDA_ZIP_get_zip_number_of_entries(unzFile uf) {
         return Z.get_zip_number_of_entries(uf);
@@ -198,6 +452,30 @@ extern "C" {
         return Z.print_zip_index(uf, 128);
     }
 
+    // Table of zip archives held in memory: (name, (buffer, size))
+    // They are opened through the memory ioapi of ida_miniunz.c instead of the filesystem
+    static map<string, pair<const char*, long>> MZ;
+
+    // Register a zip archive in memory with a name (as if it were its path)
+    void IDA_ZIP_add_memory_zip(const char *zipname, const void *buf, long size) {
+        MZ[zipname] = make_pair((const char*) buf, size);
+    }
+
+    // Get the buffer of a zip archive in memory
+    // Return 1 if zipname is a zip in memory, 0 otherwise
+    int IDA_ZIP_get_memory_zip(const char *zipname, const char **buf, long *size) {
+        auto it = MZ.find(zipname);
+        if (it == MZ.end()) return 0;
+        *buf = it->second.first;
+        *size = it->second.second;
+        return 1;
+    }
+
+    // Unregister a zip archive in memory (the buffer is not released)
+    void IDA_ZIP_remove_memory_zip(const char *zipname) {
+        MZ.erase(zipname);
+    }
+
 #ifdef __cplusplus
 }
 #endif
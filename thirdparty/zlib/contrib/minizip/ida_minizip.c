@@ -0,0 +1,338 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// Rewrite a zip archive (a SIARD file) with its entries in another order (see siard-repack).
+// Entries are copied as they are (raw, without inflating them), keeping their names, dates,
+// attributes, comments and extra fields, except:
+//   - deflated entries whose names end in ".xml" (table files) and larger than two blocks
+//     are deflated again in blocks of block_size bytes, fully flushed (Z_FULL_FLUSH) so that
+//     the stream can be inflated from the start of any block; the offsets of the blocks are
+//     stored as a seek index in the central extra field of the entry (see ida_seekindex.h)
+//   - if store_incompressible, deflated entries that deflate does not compress (to less than
+//     98% of their size, e.g. images or zip files) are inflated and stored
+// Encrypted entries are not supported.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+#include "unzip.h"
+#include "zip.h"
+#include "ida_log.h"
+#include "ida_seekindex.h"
+
+#define IDA_REPACK_BUFSIZE (1 << 16)
+
+typedef struct {
+    char *name;
+    unz64_file_pos pos;
+    int written;
+} ida_repack_entry;
+
+static int ida_repack_entry_cmp(const void *a, const void *b)
+{
+    return strcmp(((const ida_repack_entry*) a)->name, ((const ida_repack_entry*) b)->name);
+}
+
+// Remove from an extra field the blocks written by zip.c itself (ZIP64) or by the repacking
+// (seek index); return its new size
+static uInt ida_repack_clean_extra(char *extra, uInt size)
+{
+    int n = (int) size;
+    zipRemoveExtraInfoBlock(extra, &n, 0x0001);
+    zipRemoveExtraInfoBlock(extra, &n, IDA_SEEK_INDEX_ID);
+    return (uInt) n;
+}
+
+static void ida_put64(unsigned char *p, ZPOS64_T x)
+{
+    int k;
+    for (k = 0; k < 8; k++, x >>= 8) p[k] = (unsigned char) (x & 0xff);
+}
+
+// Deflate the current entry of uf (opened to read inflated data) in blocks of block_size
+// bytes, fully flushed. The seek index (an extra field block) goes to index/index_size,
+// and it must be written in the central extra field when the entry is opened in zf, before
+// its data. So the entry is deflated twice, with the same input and the same parameters:
+// with zf == NULL, to compute the index, discarding the output; then with the entry opened
+// in zf, writing the output there and checking that the blocks are at the same offsets
+// Return ZIP_OK or an error code
+static int ida_repack_deflate_blocks(unzFile uf, zipFile zf, int level, long block_size, ZPOS64_T total,
+                                     unsigned char *index, uInt max_index, uInt *index_size)
+{
+    unsigned char in[IDA_REPACK_BUFSIZE], out[IDA_REPACK_BUFSIZE];
+    unsigned char point[IDA_SEEK_INDEX_POINT_SIZE];
+    uInt npoints = 0, max_points = max_index > 4 ? (max_index - 4) / IDA_SEEK_INDEX_POINT_SIZE : 0;
+    ZPOS64_T next_flush;
+    int n, ret = Z_OK, err = ZIP_OK;
+    z_stream s;
+
+    if (max_points > IDA_SEEK_INDEX_MAX_POINTS) max_points = IDA_SEEK_INDEX_MAX_POINTS;
+    // Larger blocks if there would be too many points for the index (no blocks if no room at all)
+    if (!max_points) block_size = (long) total;
+    else if (total / (ZPOS64_T) block_size > max_points) block_size = (long) (total / max_points + 1);
+    next_flush = (ZPOS64_T) block_size;
+
+    memset(&s, 0, sizeof(s));
+    if (deflateInit2(&s, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return ZIP_INTERNALERROR;
+    while (err == ZIP_OK && ret != Z_STREAM_END) {
+        n = unzReadCurrentFile(uf, in, sizeof(in));
+        if (n < 0) {
+            err = n;
+            break;
+        }
+        unsigned char *p = in;
+        do {
+            // Feed the stream up to the next block boundary, then flush it fully
+            uInt piece = (uInt) n;
+            int flush = n ? Z_NO_FLUSH : Z_FINISH;
+            if (n && s.total_in + piece >= next_flush) {
+                piece = (uInt) (next_flush - s.total_in);
+                flush = (s.total_in + piece < total) ? Z_FULL_FLUSH : Z_NO_FLUSH;
+            }
+            s.next_in = p;
+            s.avail_in = piece;
+            do {
+                s.next_out = out;
+                s.avail_out = sizeof(out);
+                ret = deflate(&s, flush);
+                if (ret == Z_STREAM_ERROR) err = ZIP_INTERNALERROR;
+                else if (zf && s.avail_out < sizeof(out)) {
+                    err = zipWriteInFileInZip(zf, out, (unsigned) (sizeof(out) - s.avail_out));
+                }
+            } while (err == ZIP_OK && s.avail_out == 0);
+            if (err == ZIP_OK && flush == Z_FULL_FLUSH) {
+                if (npoints < max_points) {
+                    unsigned char *q = index + 4 + npoints * IDA_SEEK_INDEX_POINT_SIZE;
+                    ida_put64(point, s.total_out);
+                    ida_put64(point + 8, s.total_in);
+                    if (!zf) memcpy(q, point, IDA_SEEK_INDEX_POINT_SIZE);
+                    else if (memcmp(q, point, IDA_SEEK_INDEX_POINT_SIZE)) err = ZIP_INTERNALERROR;
+                    npoints++;
+                }
+                next_flush += (ZPOS64_T) block_size;
+            }
+            p += piece;
+            n -= piece;
+        } while (err == ZIP_OK && n > 0);
+    }
+    deflateEnd(&s);
+    if (err != ZIP_OK) return err;
+
+    if (zf) {
+        if ((npoints ? 4 + npoints * IDA_SEEK_INDEX_POINT_SIZE : 0) != *index_size) return ZIP_INTERNALERROR;
+    } else {
+        index[0] = IDA_SEEK_INDEX_ID & 0xff;
+        index[1] = IDA_SEEK_INDEX_ID >> 8;
+        index[2] = (unsigned char) ((npoints * IDA_SEEK_INDEX_POINT_SIZE) & 0xff);
+        index[3] = (unsigned char) ((npoints * IDA_SEEK_INDEX_POINT_SIZE) >> 8);
+        *index_size = npoints ? 4 + npoints * IDA_SEEK_INDEX_POINT_SIZE : 0;
+    }
+    return ZIP_OK;
+}
+
+// Copy the current entry of uf into zf (raw, except table files and, if store_incompressible,
+// incompressible entries); return ZIP_OK or an error code
+static int ida_repack_copy_entry(unzFile uf, zipFile zf, long block_size, int store_incompressible)
+{
+    char *name = NULL;
+    unz_file_info64 fi;
+    zip_fileinfo zi;
+    char *extra_local = NULL, *extra_global = NULL, *comment = NULL;
+    unsigned char *buf = NULL, *index = NULL;
+    uInt size_local = 0, size_global, index_size = 0, max_index = 0;
+    int method, level, err, n;
+    ZPOS64_T csize;
+
+    err = unzGetCurrentFileInfo64(uf, &fi, NULL, 0, NULL, 0, NULL, 0);
+    if (err != UNZ_OK) return err;
+    name = (char*) malloc(fi.size_filename + 1);
+    // Room for the seek index, besides the extra field already there
+    extra_global = (char*) malloc(fi.size_file_extra + 65536);
+    comment = (char*) malloc(fi.size_file_comment + 1);
+    buf = (unsigned char*) malloc(IDA_REPACK_BUFSIZE);
+    if (!name || !extra_global || !comment || !buf) {
+        err = ZIP_INTERNALERROR;
+        goto end;
+    }
+    err = unzGetCurrentFileInfo64(uf, &fi, name, (uLong) fi.size_filename + 1, extra_global, (uLong) fi.size_file_extra,
+                                  comment, (uLong) fi.size_file_comment + 1);
+    if (err != UNZ_OK) goto end;
+    if (fi.flag & 1) {
+        IDA_log(IDA_LOG_ERROR, "Entry '%s' is encrypted, not supported", name);
+        err = ZIP_PARAMERROR;
+        goto end;
+    }
+    size_global = ida_repack_clean_extra(extra_global, (uInt) fi.size_file_extra);
+
+    err = unzOpenCurrentFile2(uf, &method, &level, 1);
+    if (err != UNZ_OK) goto end;
+    n = unzGetLocalExtrafield(uf, NULL, 0);
+    if (n > 0 && (extra_local = (char*) malloc(n))) {
+        size_local = ida_repack_clean_extra(extra_local, (uInt) unzGetLocalExtrafield(uf, extra_local, (unsigned) n));
+    }
+
+    n = (int) strlen(name);
+    if (method == Z_DEFLATED && block_size > 0 && fi.uncompressed_size >= 2 * (ZPOS64_T) block_size
+        && n > 4 && !strcmp(name + n - 4, ".xml")) {
+        // Table file: deflate it again in blocks, with a seek index (first pass, see
+        // ida_repack_deflate_blocks())
+        unzCloseCurrentFile(uf);
+        if ((err = unzOpenCurrentFile(uf)) != UNZ_OK) goto end;
+        index = (unsigned char*) extra_global + size_global;
+        max_index = size_global < 65535 - 32 ? 65535 - 32 - size_global : 0;
+        err = ida_repack_deflate_blocks(uf, NULL, level, block_size, fi.uncompressed_size,
+                                        index, max_index, &index_size);
+        if (unzCloseCurrentFile(uf) != UNZ_OK && err == ZIP_OK) err = UNZ_CRCERROR;
+        if (err != ZIP_OK || (err = unzOpenCurrentFile(uf)) != UNZ_OK) goto end;
+        size_global += index_size;
+        // A bound of its compressed size: deflate adds 5 bytes every stored block of up to
+        // 64 KB, and every full flush a few more
+        csize = fi.uncompressed_size + (fi.uncompressed_size >> 10) + 16 * (fi.uncompressed_size / block_size + 1);
+    } else if (method == Z_DEFLATED && store_incompressible
+               && fi.compressed_size * 100 >= fi.uncompressed_size * 98) {
+        // Store it, inflated
+        unzCloseCurrentFile(uf);
+        if ((err = unzOpenCurrentFile(uf)) != UNZ_OK) goto end;
+        method = 0;
+        level = 0;
+        csize = fi.uncompressed_size;
+    } else {
+        csize = fi.compressed_size;
+    }
+
+    memset(&zi, 0, sizeof(zi));
+    zi.dosDate = fi.dosDate;
+    zi.internal_fa = fi.internal_fa;
+    zi.external_fa = fi.external_fa;
+    err = zipOpenNewFileInZip4_64(zf, name, &zi, extra_local, size_local, extra_global, size_global,
+                                  fi.size_file_comment ? comment : NULL, method, level, 1,
+                                  -MAX_WBITS, 8, Z_DEFAULT_STRATEGY, NULL, 0, fi.version, fi.flag & ~0xf,
+                                  fi.uncompressed_size >= 0xffffffff || csize >= 0xffffffff);
+    if (err != ZIP_OK) {
+        unzCloseCurrentFile(uf);
+        goto end;
+    }
+    if (index) {
+        // Table file: second pass, streamed into zf
+        err = ida_repack_deflate_blocks(uf, zf, level, block_size, fi.uncompressed_size,
+                                        index, max_index, &index_size);
+    } else {
+        // Raw (compressed) data, or inflated data to store
+        while (err == ZIP_OK && (n = unzReadCurrentFile(uf, buf, IDA_REPACK_BUFSIZE)) > 0) {
+            err = zipWriteInFileInZip(zf, buf, (unsigned) n);
+        }
+        if (n < 0) err = n;
+    }
+    // Inflated data: its CRC is checked here
+    if (unzCloseCurrentFile(uf) != UNZ_OK && err == ZIP_OK) err = UNZ_CRCERROR;
+    // zip.c counts the compressed bytes written; the sizes and CRC given are those of the
+    // uncompressed data, the same as in uf
+    if (err == ZIP_OK) {
+        err = zipCloseFileInZipRaw64(zf, fi.uncompressed_size, fi.crc);
+    }
+
+end:
+    if (err != ZIP_OK) IDA_log(IDA_LOG_ERROR, "Error %d repacking entry '%s'", err, name ? name : "");
+    free(name);
+    free(extra_local);
+    free(extra_global);
+    free(comment);
+    free(buf);
+    return err;
+}
+
+// Repack the zip zipin into zipout: first the entries named in order[0..norder-1] (names not
+// found are ignored), then the rest of the entries in their order in zipin
+// Return 0 if OK, or an error code otherwise
+int IDA_minizip_repack(const char *zipin, const char *zipout, const char **order, long norder,
+                       long block_size, int store_incompressible)
+{
+    unzFile uf;
+    zipFile zf;
+    unz_global_info64 gi;
+    ida_repack_entry *entries = NULL, *sorted = NULL;
+    char *global_comment = NULL;
+    long nentries = 0, k;
+    int err;
+
+    if (!(uf = unzOpen64(zipin))) {
+        IDA_log(IDA_LOG_ERROR, "Cannot open zip file '%s'", zipin);
+        return UNZ_ERRNO;
+    }
+    err = unzGetGlobalInfo64(uf, &gi);
+    if (err == UNZ_OK && (global_comment = (char*) calloc(gi.size_comment + 1, 1)) && gi.size_comment > 0) {
+        unzGetGlobalComment(uf, global_comment, gi.size_comment + 1);
+    }
+    entries = (ida_repack_entry*) calloc(gi.number_entry + 1, sizeof(ida_repack_entry));
+    sorted = (ida_repack_entry*) calloc(gi.number_entry + 1, sizeof(ida_repack_entry));
+    if (err != UNZ_OK || !entries || !sorted || !global_comment) {
+        err = (err != UNZ_OK) ? err : UNZ_INTERNALERROR;
+        goto end;
+    }
+
+    // Entries in archive order; their index in 'written', to find them by name
+    for (err = unzGoToFirstFile(uf); err == UNZ_OK && nentries < (long) gi.number_entry; err = unzGoToNextFile(uf)) {
+        unz_file_info64 fi;
+        if ((err = unzGetCurrentFileInfo64(uf, &fi, NULL, 0, NULL, 0, NULL, 0)) != UNZ_OK) break;
+        if (!(entries[nentries].name = (char*) malloc(fi.size_filename + 1))) {
+            err = UNZ_INTERNALERROR;
+            break;
+        }
+        // Counted in nentries from here, to be freed
+        nentries++;
+        if ((err = unzGetCurrentFileInfo64(uf, NULL, entries[nentries-1].name, (uLong) fi.size_filename + 1,
+                                           NULL, 0, NULL, 0)) != UNZ_OK
+            || (err = unzGetFilePos64(uf, &entries[nentries-1].pos)) != UNZ_OK) {
+            break;
+        }
+        sorted[nentries-1] = entries[nentries-1];
+        sorted[nentries-1].written = (int) (nentries - 1);
+    }
+    if (err != UNZ_END_OF_LIST_OF_FILE && err != UNZ_OK) goto end;
+    qsort(sorted, nentries, sizeof(ida_repack_entry), ida_repack_entry_cmp);
+
+    if (!(zf = zipOpen64(zipout, APPEND_STATUS_CREATE))) {
+        IDA_log(IDA_LOG_ERROR, "Cannot create zip file '%s'", zipout);
+        err = ZIP_ERRNO;
+        goto end;
+    }
+    err = ZIP_OK;
+    for (k = 0; err == ZIP_OK && k < norder + nentries; k++) {
+        ida_repack_entry *e;
+        if (k < norder) {
+            ida_repack_entry key;
+            ida_repack_entry *s;
+            key.name = (char*) order[k];
+            s = (ida_repack_entry*) bsearch(&key, sorted, nentries, sizeof(ida_repack_entry), ida_repack_entry_cmp);
+            if (!s) continue;
+            e = &entries[s->written];
+        } else {
+            e = &entries[k - norder];
+        }
+        if (e->written) continue;
+        e->written = 1;
+        err = unzGoToFilePos64(uf, &e->pos);
+        if (err == UNZ_OK) err = ida_repack_copy_entry(uf, zf, block_size, store_incompressible);
+    }
+    if (zipClose(zf, gi.size_comment > 0 ? global_comment : NULL) != ZIP_OK && err == ZIP_OK) err = ZIP_ERRNO;
+    if (err == ZIP_OK) IDA_log(IDA_LOG_DEBUG, "Repacked %ld entries of '%s' into '%s'", nentries, zipin, zipout);
+
+end:
+    for (k = 0; k < nentries; k++) free(entries[k].name);
+    free(entries);
+    free(sorted);
+    free(global_comment);
+    unzClose(uf);
+    return err;
+}
@@ -0,0 +1,477 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// Parallel inflate of one large deflate stream (a big zip entry, e.g. a table file)
+//
+// A deflate stream can only be decoded from its start: blocks are not aligned to bytes,
+// and back-references reach up to 32 KB back into the output of previous blocks. As in
+// pugz, the compressed data is split into chunks that are decoded concurrently:
+//
+//   - every chunk but the first one starts at the first bit after its nominal start where
+//     a dynamic block header is found whose whole block decodes without errors (a guess)
+//   - as the 32 KB window before a chunk is unknown, the chunk is decoded with a placeholder
+//     dictionary holding the low byte of each window position, and decoded again with a second
+//     dictionary holding the high bits of the position (and different from the first one
+//     everywhere): the bytes that differ are the ones copied from the window, and together
+//     they give the window position (in XML, copies of tags go on through the whole chunk;
+//     the second pass stops early only if 32 KB of output in a row are equal, as no byte
+//     after them can depend on the window)
+//   - a chunk is decoded until the first block boundary at or after the nominal start of
+//     the next one, which must be exactly where the next chunk guessed it starts
+//   - finally, chunk by chunk, the bytes copied from the window are replaced by the actual
+//     bytes at the end of the previous chunk, and the CRC-32 of the output is checked
+//
+// As the first chunk is decoded once and the others twice, the first chunk is twice as large
+// as the others: with n threads the stream is inflated up to (n+1)/2 times faster, using
+// about three times the memory of the output.
+//
+// Any mismatch (a wrong guess, a size or CRC error) makes the parallel inflate fail, and the
+// caller inflates the stream sequentially. On ivm64 (no threads) it always fails.
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#ifndef __ivm64__
+#include <thread>
+#include <system_error>
+#endif
+
+#include "zlib.h"
+#include "ida_log.h"
+
+using namespace std;
+
+namespace IDA {
+
+    class IDA_parallel_inflate {
+        static const long WINDOW = 32768;            // Deflate window
+        static const long MIN_CHUNK = 1L << 20;      // Minimum compressed bytes per chunk
+        static const long SEARCH_LIMIT = 4L << 20;   // Compressed bytes searched for the first block of a chunk
+
+        // Placeholder dictionaries: low[k] is the low byte of position k, high[k] keeps the
+        // high bits of k (high[k] >> 1) and is always different from low[k]
+        unsigned char dict_low[WINDOW], dict_high[WINDOW];
+
+        const unsigned char *in;
+        long in_size;
+
+        struct chunk {
+            long nominal = 0;                   // Nominal start (byte)
+            long start_bit = 0;                 // Start of its first block (bit)
+            long end_bit = -1;                  // Block boundary where it stopped (bit)
+            bool ok = false;
+            unsigned char *out = NULL;          // Output, first pass (allocated with malloc())
+            long out_size = 0;
+            unsigned char *high = NULL;         // Output, second pass, while it may depend on the window
+            long high_size = 0;
+            unsigned long crc = 0;
+        };
+        vector<chunk> chunks;
+        long expected_size = 0;                 // Size of the whole output
+
+        // A raw inflate stream over the input, positioned at any bit
+        struct decoder {
+            z_stream s;
+            const unsigned char *in, *end;
+            bool ok;
+
+            decoder(const unsigned char *in, long in_size) : in(in), end(in + in_size)
+            {
+                memset(&s, 0, sizeof(s));
+                ok = (inflateInit2(&s, -15) == Z_OK);
+            }
+            ~decoder() { if (ok) inflateEnd(&s); }
+
+            bool start(long bit, const unsigned char *dict)
+            {
+                long byte = bit >> 3;
+                int shift = bit & 7;
+                if (!ok || byte >= end - in || inflateReset(&s) != Z_OK) return false;
+                if (shift) {
+                    if (inflatePrime(&s, 8 - shift, in[byte] >> shift) != Z_OK) return false;
+                    byte++;
+                }
+                s.next_in = (Bytef*) (in + byte);
+                return !dict || inflateSetDictionary(&s, dict, WINDOW) == Z_OK;
+            }
+
+            // Inflate into dst (at most room bytes); set the bytes produced and return the zlib code
+            int run(unsigned char *dst, long room, int flush, long &produced)
+            {
+                s.next_out = dst;
+                s.avail_out = (uInt) min(room, 1L << 30);
+                s.avail_in = (uInt) min((long) (end - (const unsigned char*) s.next_in), 1L << 30);
+                int ret = inflate(&s, flush);
+                produced = (unsigned char*) s.next_out - dst;
+                return ret;
+            }
+
+            bool at_block_boundary() { return s.data_type & 128; }
+            bool input_left() { return (const unsigned char*) s.next_in < end; }
+            long bit_pos() { return ((const unsigned char*) s.next_in - in) * 8 - (s.data_type & 7); }
+        };
+
+        unsigned get_bits(long bit, int n)
+        {
+            unsigned v = 0;
+            for (int i = 0; i < n; i++, bit++) {
+                v |= ((in[bit >> 3] >> (bit & 7)) & 1u) << i;
+            }
+            return v;
+        }
+
+        // Is there a (non final) dynamic block starting at this bit? Cheap checks of its header
+        // first (type, number of codes, complete code lengths code), then zlib decodes the block
+        bool is_block_start(decoder &d, long bit, vector<unsigned char> &scratch)
+        {
+            if (bit + 17 + 3 * 19 >= in_size * 8) return false;
+            if (get_bits(bit, 3) != 4) return false;  // BFINAL = 0, BTYPE = 2 (dynamic)
+            if (get_bits(bit + 3, 5) > 29 || get_bits(bit + 8, 5) > 29) return false;
+            int ncodes = get_bits(bit + 13, 4) + 4;
+            unsigned kraft = 0;
+            for (int i = 0; i < ncodes; i++) {
+                unsigned len = get_bits(bit + 17 + 3 * i, 3);
+                if (len) kraft += 128 >> len;
+            }
+            if (kraft != 128) return false;
+
+            // Header (code trees), then the block, with any dictionary (its content is unknown)
+            long produced;
+            if (!d.start(bit, NULL) || d.run(scratch.data(), scratch.size(), Z_TREES, produced) != Z_OK
+                || !(d.s.data_type & 256) || inflateSetDictionary(&d.s, dict_low, WINDOW) != Z_OK) {
+                return false;
+            }
+            for (;;) {
+                int ret = d.run(scratch.data(), scratch.size(), Z_BLOCK, produced);
+                if (ret != Z_OK) return false;
+                if (d.at_block_boundary()) break;
+                if (!produced && !d.input_left()) return false;
+            }
+            // The next block must have a valid type
+            long next = d.bit_pos();
+            return next + 3 <= in_size * 8 && get_bits(next + 1, 2) != 3;
+        }
+
+        // Decode chunk i: find its start (but the first one), decode it until the next chunk,
+        // and find its bytes copied from the window
+        void decode_chunk(size_t i)
+        {
+            chunk &c = chunks[i];
+            bool last = (i + 1 == chunks.size());
+            long stop_bit = last ? -1 : chunks[i + 1].nominal * 8;
+            decoder d(in, in_size);
+            vector<unsigned char> scratch(1L << 16);
+
+            if (i > 0) {
+                long limit = min(stop_bit >= 0 ? stop_bit : in_size * 8, (c.nominal + SEARCH_LIMIT) * 8);
+                long bit = c.nominal * 8;
+                while (bit < limit && !is_block_start(d, bit, scratch)) bit++;
+                if (bit >= limit) return;
+                c.start_bit = bit;
+            }
+
+            // First pass: the output, with the low byte of the window position where unknown
+            if (!d.start(c.start_bit, i > 0 ? dict_low : NULL)) return;
+            // (the output of a chunk is estimated proportional to its input)
+            long in_chunk = (last ? in_size : stop_bit / 8) - c.nominal;
+            long capacity = (long) ((double) expected_size * in_chunk / in_size * 1.1) + MIN_CHUNK;
+            long n = 0, produced;
+            if (!(c.out = (unsigned char*) malloc(capacity))) return;
+            for (;;) {
+                if (capacity - n < (1L << 16)) {
+                    unsigned char *more = (unsigned char*) realloc(c.out, 2 * capacity);
+                    if (!more) return;
+                    c.out = more;
+                    capacity *= 2;
+                }
+                int ret = d.run(c.out + n, capacity - n, Z_BLOCK, produced);
+                n += produced;
+                if (n > expected_size) return;
+                if (ret == Z_STREAM_END) {
+                    if (!last) return; // The stream ends before the next chunk
+                    c.end_bit = d.bit_pos();
+                    break;
+                }
+                if (ret != Z_OK || (!produced && !d.input_left())) return;
+                if (!last && d.at_block_boundary() && d.bit_pos() >= stop_bit) {
+                    c.end_bit = d.bit_pos();
+                    break;
+                }
+            }
+            c.out_size = n;
+
+            // Second pass, until 32 KB in a row do not depend on the window
+            if (i > 0) {
+                if (!d.start(c.start_bit, dict_high) || !(c.high = (unsigned char*) malloc(n + 1))) return;
+                long pos = 0, last_ref = -1;
+                while (pos < n && pos - (last_ref + 1) < WINDOW) {
+                    int ret = d.run(c.high + pos, min(1L << 16, n - pos), Z_NO_FLUSH, produced);
+                    if ((ret != Z_OK && ret != Z_STREAM_END) || !produced) return;
+                    for (long j = pos; j < pos + produced; j++) {
+                        if (c.out[j] != c.high[j]) last_ref = j;
+                    }
+                    pos += produced;
+                }
+                c.high_size = pos;
+            }
+            c.ok = true;
+        }
+
+        void crc_chunk(size_t i, long offset, const unsigned char *buf)
+        {
+            chunk &c = chunks[i];
+            c.crc = crc32(0L, Z_NULL, 0);
+            for (long done = 0; done < c.out_size; ) {
+                long n = min(c.out_size - done, 1L << 30);
+                c.crc = crc32(c.crc, buf + offset + done, (uInt) n);
+                done += n;
+            }
+        }
+
+#ifndef __ivm64__
+        // Run f(i) for every chunk, each one in its own thread (the first one in this thread)
+        template<typename F> bool for_each_chunk(F f)
+        {
+            vector<thread> workers;
+            bool ok = true;
+            try {
+                for (size_t i = 1; i < chunks.size(); i++) workers.push_back(thread(f, i));
+            } catch (...) {
+                ok = false;
+            }
+            f(0);
+            for (auto &w: workers) w.join();
+            return ok;
+        }
+#endif
+
+    public:
+        ~IDA_parallel_inflate()
+        {
+            for (auto &c: chunks) {
+                free(c.out);
+                free(c.high);
+            }
+        }
+
+        IDA_parallel_inflate(const unsigned char *in, long in_size) : in(in), in_size(in_size)
+        {
+            for (long k = 0; k < WINDOW; k++) {
+                unsigned char h = (unsigned char) (2 * (k >> 8));
+                dict_low[k] = (unsigned char) k;
+                dict_high[k] = h + (h == dict_low[k] ? 1 : 0);
+            }
+        }
+
+        // Inflate the stream with up to nthreads threads into a buffer of out_size (+1) bytes
+        // allocated with malloc(); return NULL if it cannot be done in parallel
+        char *inflate_all(long out_size, unsigned long crc, int nthreads)
+        {
+#ifdef __ivm64__
+            return NULL;
+#else
+            // The first chunk is 2/(n+1) of the input, the others 1/(n+1)
+            long nchunks = min((long) nthreads, in_size / MIN_CHUNK - 1);
+            if (nchunks < 2) return NULL;
+            expected_size = out_size;
+            chunks.resize(nchunks);
+            for (long i = 1; i < nchunks; i++) chunks[i].nominal = (long) ((double) in_size * (i + 1) / (nchunks + 1));
+
+            bool ok = true;
+            try {
+                ok = for_each_chunk([this](size_t i) {
+                    try {
+                        decode_chunk(i);
+                    } catch (const bad_alloc &e) {
+                        chunks[i].ok = false;
+                    }
+                });
+            } catch (const bad_alloc &e) {
+                ok = false;
+            }
+
+            long total = 0, nrefs = 0;
+            for (size_t i = 0; ok && i < chunks.size(); i++) {
+                if (!chunks[i].ok) {
+                    IDA_log(IDA_LOG_DEBUG, "Parallel inflate: chunk %ld not decoded, inflating sequentially", (long) i);
+                    ok = false;
+                } else if (i + 1 < chunks.size() && chunks[i].end_bit != chunks[i + 1].start_bit) {
+                    IDA_log(IDA_LOG_DEBUG, "Parallel inflate: chunk %ld not in sync, inflating sequentially", (long) i + 1);
+                    ok = false;
+                }
+                total += chunks[i].out_size;
+            }
+            if (ok && total != out_size) {
+                IDA_log(IDA_LOG_DEBUG, "Parallel inflate: %ld bytes instead of %ld, inflating sequentially", total, out_size);
+                ok = false;
+            }
+            char *buf = ok ? (char*) malloc(out_size + 1) : NULL;
+            if (!buf) return NULL;
+
+            // Assemble the chunks in order, taking the bytes from the window of each one from
+            // the (already complete) previous chunks
+            vector<long> offsets;
+            long offset = 0;
+            for (auto &c: chunks) {
+                offsets.push_back(offset);
+                memcpy(buf + offset, c.out, c.out_size);
+                if (c.high) {
+                    if (offset < WINDOW) {
+                        free(buf);
+                        return NULL;
+                    }
+                    const unsigned char *window = (unsigned char*) buf + offset - WINDOW;
+                    for (long j = 0; j < c.high_size; j++) {
+                        if (c.out[j] != c.high[j]) {
+                            buf[offset + j] = window[((c.high[j] >> 1) << 8) | c.out[j]];
+                            nrefs++;
+                        }
+                    }
+                }
+                free(c.out);
+                free(c.high);
+                c.out = c.high = NULL;
+                offset += c.out_size;
+            }
+
+            // CRC-32 of every chunk in parallel, then combined
+            for_each_chunk([this, &offsets, buf](size_t i) { crc_chunk(i, offsets[i], (unsigned char*) buf); });
+            unsigned long out_crc = chunks[0].crc;
+            for (size_t i = 1; i < chunks.size(); i++) {
+                out_crc = crc32_combine(out_crc, chunks[i].crc, chunks[i].out_size);
+            }
+            if (out_crc != crc) {
+                IDA_log(IDA_LOG_DEBUG, "Parallel inflate: CRC error, inflating sequentially");
+                free(buf);
+                return NULL;
+            }
+            IDA_log(IDA_LOG_DEBUG, "Parallel inflate: %ld chunks, %ld bytes (%ld copied from the window before a chunk)",
+                    nchunks, out_size, nrefs);
+            return buf;
+#endif
+        }
+
+        // Inflate the stream, whose output is fully flushed at the points of a seek index
+        // (compressed offsets cpos[], uncompressed offsets upos[], npoints of them besides the
+        // start), with up to nthreads threads: as no data before a point is needed to inflate
+        // from it, each thread inflates a range of points straight into its place in the output
+        // Return the output (out_size (+1) bytes allocated with malloc()), or NULL if it cannot
+        // be done in parallel or the index does not match the stream
+        char *inflate_indexed(long out_size, unsigned long crc, int nthreads,
+                              const long *cpos, const long *upos, long npoints)
+        {
+#ifdef __ivm64__
+            return NULL;
+#else
+            long nchunks = min((long) nthreads, npoints + 1);
+            if (nchunks < 2) return NULL;
+            for (long k = 0; k < npoints; k++) {
+                if (cpos[k] <= (k ? cpos[k - 1] : 0) || upos[k] <= (k ? upos[k - 1] : 0)
+                    || cpos[k] >= in_size || upos[k] >= out_size) {
+                    IDA_log(IDA_LOG_DEBUG, "Parallel inflate: bad seek index, inflating sequentially");
+                    return NULL;
+                }
+            }
+            char *buf = (char*) malloc(out_size + 1);
+            if (!buf) return NULL;
+            expected_size = out_size;
+            // Chunk i goes from point first[i] (0 is the start) to the next chunk or the end
+            chunks.resize(nchunks);
+            vector<long> offsets(nchunks), ends(nchunks);
+            for (long i = 0; i < nchunks; i++) {
+                long p = (npoints + 1) * i / nchunks;
+                chunks[i].nominal = p ? cpos[p - 1] : 0;
+                offsets[i] = p ? upos[p - 1] : 0;
+            }
+            for (long i = 0; i < nchunks; i++) {
+                ends[i] = (i + 1 < nchunks) ? chunks[i + 1].nominal : in_size;
+                chunks[i].out_size = ((i + 1 < nchunks) ? offsets[i + 1] : out_size) - offsets[i];
+            }
+
+            for_each_chunk([this, buf, &offsets, &ends, nchunks](size_t i) {
+                chunk &c = chunks[i];
+                decoder d(in, ends[i]);
+                long produced;
+                int ret = Z_OK;
+                c.ok = d.start(c.nominal * 8, NULL);
+                unsigned char *dst = (unsigned char*) buf + offsets[i];
+                long room = c.out_size;
+                // Once the output is complete, go on to consume the empty block of the flush
+                while (c.ok && ret == Z_OK && (room > 0 || d.input_left())) {
+                    ret = d.run(dst, room, Z_SYNC_FLUSH, produced);
+                    dst += produced;
+                    room -= produced;
+                }
+                // The last chunk ends the stream; the others end at a flush point
+                c.ok = c.ok && !room && ((long) i + 1 < nchunks ? (ret == Z_OK || ret == Z_BUF_ERROR) && !d.input_left()
+                                                                : ret == Z_STREAM_END);
+                if (c.ok) crc_chunk(i, offsets[i], (unsigned char*) buf);
+            });
+
+            unsigned long out_crc = 0;
+            for (long i = 0; i < nchunks; i++) {
+                if (!chunks[i].ok) {
+                    IDA_log(IDA_LOG_DEBUG, "Parallel inflate: chunk %ld of the seek index not decoded, inflating sequentially", i);
+                    free(buf);
+                    return NULL;
+                }
+                out_crc = i ? crc32_combine(out_crc, chunks[i].crc, chunks[i].out_size) : chunks[i].crc;
+            }
+            if (out_crc != crc) {
+                IDA_log(IDA_LOG_DEBUG, "Parallel inflate: CRC error, inflating sequentially");
+                free(buf);
+                return NULL;
+            }
+            IDA_log(IDA_LOG_DEBUG, "Parallel inflate: %ld chunks from a seek index of %ld points, %ld bytes",
+                    nchunks, npoints, out_size);
+            return buf;
+#endif
+        }
+    };
+
+}  /* namespace IDA */
+
+
+/* C public API */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+    using namespace IDA;
+
+    // Inflate a raw deflate stream of in_size bytes into a buffer (allocated with malloc(), with
+    // one extra byte) of out_size bytes whose CRC-32 is crc, using up to nthreads threads
+    // Return NULL if it cannot be done in parallel (then the stream must be inflated sequentially)
+    char *IDA_ZIP_parallel_inflate(const unsigned char *in, long in_size, long out_size, unsigned long crc,
+                                   int nthreads) {
+        IDA_parallel_inflate *p = new (nothrow) IDA_parallel_inflate(in, in_size);
+        if (!p) return NULL;
+        char *buf = p->inflate_all(out_size, crc, nthreads);
+        delete p;
+        return buf;
+    }
+
+    // As IDA_ZIP_parallel_inflate(), for a stream fully flushed at the npoints points of a seek
+    // index (see ida_seekindex.h): compressed offsets cpos[] and uncompressed offsets upos[]
+    char *IDA_ZIP_parallel_inflate_indexed(const unsigned char *in, long in_size, long out_size, unsigned long crc,
+                                           int nthreads, const long *cpos, const long *upos, long npoints) {
+        IDA_parallel_inflate *p = new (nothrow) IDA_parallel_inflate(in, in_size);
+        if (!p) return NULL;
+        char *buf = p->inflate_indexed(out_size, crc, nthreads, cpos, upos, npoints);
+        delete p;
+        return buf;
+    }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,70 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+// USDT (user-level statically defined tracing) probes on the hot paths
+// of the conversion, to attach to with bpftrace or perf without rebuilding:
+//
+//   bpftrace -e 'usdt:./siard2sql:siard2sql:table__start { printf("%s\n", str(arg1)); }'
+//   perf probe -x ./siard2sql sdt_siard2sql:rows__progress
+//
+// Probes (provider 'siard2sql'):
+//   table__start(schema, table, rows)             table__end(schema, table, rows)
+//   entry__extract__start(zipfile, entry)         entry__extract__end(zipfile, entry, bytes, err)
+//   lob__read__start(table, lobfile)              lob__read__end(table, lobfile, bytes)
+//   rows__progress(table, rows, bytes)            every IDA_PROBE_ROWS_INTERVAL rows of a table
+//
+// Strings are passed as 'const char*' and counters as 'long'. A disabled probe is
+// a single nop instruction. Probes are compiled out on ivm64, if <sys/sdt.h> is not
+// available, or if IDA_NO_PROBES is defined.
+//
+// Each probe has a semaphore (siard2sql_<name>_semaphore, defined in ida_miniunz.c) that
+// the tracer increments while it is attached; arguments that cost something to compute
+// are only computed if IDA_PROBE_ENABLED(name), e.g.:
+//
+//   if (IDA_PROBE_ENABLED(table__start)) IDA_PROBE3(table__start, s, t, atol(rows));
+
+#ifndef _IDA_PROBES_H_
+#define _IDA_PROBES_H_
+
+#define IDA_PROBE_ROWS_INTERVAL 1000
+
+#if !defined(IDA_NO_PROBES) && !defined(__ivm64__) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define IDA_PROBES_ENABLED 1
+#endif
+#endif
+
+#ifdef IDA_PROBES_ENABLED
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern unsigned short siard2sql_table__start_semaphore, siard2sql_table__end_semaphore,
+                      siard2sql_entry__extract__start_semaphore, siard2sql_entry__extract__end_semaphore,
+                      siard2sql_lob__read__start_semaphore, siard2sql_lob__read__end_semaphore,
+                      siard2sql_rows__progress_semaphore;
+#ifdef __cplusplus
+}
+#endif
+#define IDA_PROBE_ENABLED(name)               __builtin_expect(siard2sql_##name##_semaphore, 0)
+#define IDA_PROBE2(name, a1, a2)              DTRACE_PROBE2(siard2sql, name, a1, a2)
+#define IDA_PROBE3(name, a1, a2, a3)          DTRACE_PROBE3(siard2sql, name, a1, a2, a3)
+#define IDA_PROBE4(name, a1, a2, a3, a4)      DTRACE_PROBE4(siard2sql, name, a1, a2, a3, a4)
+#else
+#define IDA_PROBE_ENABLED(name)               0
+#define IDA_PROBE2(name, a1, a2)              do {} while (0)
+#define IDA_PROBE3(name, a1, a2, a3)          do {} while (0)
+#define IDA_PROBE4(name, a1, a2, a3, a4)      do {} while (0)
+#endif
+
+#endif
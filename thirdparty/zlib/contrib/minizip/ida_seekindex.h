@@ -0,0 +1,26 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+
+    Oct 2026
+*/
+
+#ifndef _IDA_SEEKINDEX_H_
+#define _IDA_SEEKINDEX_H_
+
+// Seek index of a deflated zip entry, written by siard-repack (see ida_minizip.c) in the
+// extra field of the central directory: the points where the deflate stream was fully
+// flushed (Z_FULL_FLUSH), from which it can be inflated with no previous data (see
+// IDA_ZIP_parallel_inflate_indexed() in ida_pinflate.cpp). Each point is a pair of
+// little-endian 64-bit offsets from the start of the entry data: compressed, uncompressed.
+// The start of the stream (0, 0) is not stored.
+#define IDA_SEEK_INDEX_ID         0x5349  /* "IS" */
+#define IDA_SEEK_INDEX_POINT_SIZE 16
+#define IDA_SEEK_INDEX_MAX_POINTS 4000    /* So that the extra field fits in 64 KB */
+
+#endif
@@ -58,6 +58,11 @@
 
 #include "unzip.h"
 
+/* Per-entry messages when extracting (siard2sql redirects them to its log) */
+#ifndef MINIUNZ_VERBOSE_PRINTF
+#define MINIUNZ_VERBOSE_PRINTF printf
+#endif
+
 #define CASESENSITIVITY (0)
 #define WRITEBUFFERSIZE (8192)
 #define MAXFILENAME (256)
@@ -358,7 +363,7 @@ static int do_extract_currentfile(uf,popt_extract_without_path,popt_overwrite,pa
     {
         if ((*popt_extract_without_path)==0)
         {
-            printf("creating directory: %s\n",filename_inzip);
+            MINIUNZ_VERBOSE_PRINTF("creating directory: %s\n",filename_inzip);
             mymkdir(filename_inzip);
         }
     }
@@ -436,7 +441,7 @@ static int do_extract_currentfile(uf,popt_extract_without_path,popt_overwrite,pa
 
         if (fout!=NULL)
         {
-            printf(" extracting: %s\n",write_filename);
+            MINIUNZ_VERBOSE_PRINTF(" extracting: %s\n",write_filename);
 
             do
             {